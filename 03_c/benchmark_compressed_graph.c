@@ -0,0 +1,155 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "compressed_graph.h"
+#include "graph.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Fills a graph with random edges. Most edges point to nearby nodes, as is
+// typical for real graphs with some locality.
+void fill_random_graph(struct graph *_graph)
+{
+    uint64_t state = 42;
+
+    for (size_t i = 0; i < _graph->nodes_size; ++i) {
+        _graph->nodes[i].id = (int) i;
+    }
+
+    for (size_t i = 0; i < _graph->edges_size; ++i) {
+        // Simple xorshift pseudo random numbers
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        const size_t from     = (size_t) (state % _graph->nodes_size);
+        const size_t distance = (size_t) ((state >> 32) % ((state >> 20) & 1 ? 1024 : _graph->nodes_size));
+
+        _graph->edges[i].from = from;
+        _graph->edges[i].to   = (from + distance) % _graph->nodes_size;
+    }
+}
+
+// Orders size_t values, used for qsort.
+int compare_size(const void *_a, const void *_b)
+{
+    const size_t a = *(const size_t *) _a;
+    const size_t b = *(const size_t *) _b;
+
+    return (a > b) - (a < b);
+}
+
+// Checks that both decoders reproduce the edges of the original graph, i.e.
+// the sorted targets of every node including duplicates.
+int verify(const struct graph *_graph, const struct compressed_graph *_compressed)
+{
+    if (_compressed->nodes_size != _graph->nodes_size) {
+        return 0;
+    }
+
+    // Group the original targets by source (counting sort) and sort them
+    size_t *offsets = calloc(_graph->nodes_size + 1, sizeof(size_t));
+    size_t *targets = malloc(sizeof(size_t) * (_graph->edges_size + 1));
+    if (offsets == NULL || targets == NULL) {
+        free(offsets);
+        free(targets);
+        return 0;
+    }
+
+    for (size_t i = 0; i < _graph->edges_size; ++i) {
+        ++offsets[_graph->edges[i].from + 1];
+    }
+
+    for (size_t i = 0; i < _graph->nodes_size; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    for (size_t i = 0; i < _graph->edges_size; ++i) {
+        targets[offsets[_graph->edges[i].from]++] = _graph->edges[i].to;
+    }
+
+    // The offsets were advanced to the ends, shift them back
+    for (size_t i = _graph->nodes_size; i > 0; --i) {
+        offsets[i] = offsets[i - 1];
+    }
+    offsets[0] = 0;
+
+    for (size_t i = 0; i < _graph->nodes_size; ++i) {
+        qsort(targets + offsets[i], offsets[i + 1] - offsets[i], sizeof(size_t), compare_size);
+    }
+
+    // Compare the decoded lists of both decoders with the original ones
+    int ok = 1;
+    for (uint32_t i = 0; i < _compressed->nodes_size && ok; ++i) {
+        const size_t degree = offsets[i + 1] - offsets[i];
+        const size_t size   = COMPRESSED_GRAPH_BUFFER_SIZE(degree) + 1;
+        uint32_t    *scalar = malloc(sizeof(uint32_t) * size);
+        uint32_t    *simd   = malloc(sizeof(uint32_t) * size);
+
+        if (scalar == NULL || simd == NULL) {
+            ok = 0;
+        } else {
+            const uint32_t a = compressed_graph_neighbors(_compressed, i, scalar, COMPRESSED_GRAPH_DECODER_SCALAR);
+            const uint32_t b = compressed_graph_neighbors(_compressed, i, simd, COMPRESSED_GRAPH_DECODER_AVX2);
+
+            ok = a == degree && b == degree;
+            for (uint32_t j = 0; j < a && ok; ++j) {
+                ok = scalar[j] == targets[offsets[i] + j] && simd[j] == targets[offsets[i] + j];
+            }
+        }
+
+        free(scalar);
+        free(simd);
+    }
+
+    free(offsets);
+    free(targets);
+    return ok;
+}
+
+// Compresses a random graph and reports compression ratio and decode
+// throughput. Usage: 03_c_benchmark_compressed_graph [nodes] [edges]
+int main(int _argc, char **_argv)
+{
+    const size_t nodes = _argc > 1 ? strtoull(_argv[1], NULL, 10) : (size_t) 1 << 18;
+    const size_t edges = _argc > 2 ? strtoull(_argv[2], NULL, 10) : (size_t) 1 << 22;
+
+    // Create the original graph
+    struct graph g = create_graph(nodes, edges);
+    if (g.nodes_size != nodes || g.edges_size != edges || nodes == 0) {
+        destroy_graph(g);
+        puts("Could not allocate graph.");
+        return EXIT_FAILURE;
+    }
+
+    fill_random_graph(&g);
+
+    // Compress it
+    struct compressed_graph c = compress_graph(&g);
+    if (c.nodes_size != nodes) {
+        destroy_graph(g);
+        puts("Could not compress graph.");
+        return EXIT_FAILURE;
+    }
+
+    printf("nodes: %zu, edges: %zu\n", nodes, edges);
+    printf("struct edge array: %zu bytes (%.2f bytes per edge)\n", sizeof(struct edge) * edges, (double) sizeof(struct edge));
+    printf("compressed graph:  %zu bytes (%.2f bytes per edge)\n", compressed_graph_bytes(&c), (double) compressed_graph_bytes(&c) / (double) edges);
+    printf("compression ratio: %.2fx\n", compressed_graph_ratio(&g, &c));
+    printf("decoders correct:  %s\n", verify(&g, &c) ? "yes" : "no");
+
+    // Measure decoding
+    printf("scalar decoding:   %.1f M edges/s\n", compressed_graph_decode_throughput(&c, COMPRESSED_GRAPH_DECODER_SCALAR, 5) * 1e-6);
+    if (compressed_graph_has_avx2()) {
+        printf("AVX2 decoding:     %.1f M edges/s\n", compressed_graph_decode_throughput(&c, COMPRESSED_GRAPH_DECODER_AVX2, 5) * 1e-6);
+    } else {
+        puts("AVX2 decoding:     not supported");
+    }
+
+    destroy_compressed_graph(c);
+    destroy_graph(g);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "dynamic_graph.h"
+#include "graph.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// The parameters of the benchmark.
+struct parameters {
+    size_t nodes;
+    size_t ops;
+    size_t batch;
+};
+
+// The state shared with the reader thread.
+struct reader_state {
+    struct dynamic_graph *graph;
+    size_t                nodes;
+    atomic_int            done;
+    size_t                snapshots;
+    size_t                neighbors;
+};
+
+// Returns the current time in seconds.
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// Simple xorshift pseudo random numbers.
+uint64_t next_random(uint64_t *_state)
+{
+    *_state ^= *_state << 13;
+    *_state ^= *_state >> 7;
+    *_state ^= *_state << 17;
+    return *_state;
+}
+
+// Generates a stream of changes. About 10 % are deletes of existing edges.
+// Returns the number of edges remaining after applying all of them.
+size_t generate_ops(const struct parameters *_parameters, struct dynamic_graph_op *_ops)
+{
+    // Edges that are currently present, deletes pick one of them
+    struct edge *alive      = malloc(sizeof(struct edge) * _parameters->ops);
+    size_t       alive_size = 0;
+    uint64_t     state      = 42;
+
+    for (size_t i = 0; i < _parameters->ops; ++i) {
+        const uint64_t random = next_random(&state);
+
+        if (alive_size != 0 && random % 10 == 0) {
+            const size_t index = (size_t) (random >> 8) % alive_size;
+            _ops[i]            = (struct dynamic_graph_op) {alive[index].from, alive[index].to, DYNAMIC_GRAPH_DELETE};
+            alive[index]       = alive[--alive_size];
+        } else {
+            const size_t from = (size_t) (random >> 8) % _parameters->nodes;
+            const size_t to   = (size_t) (random >> 36) % _parameters->nodes;
+            _ops[i]           = (struct dynamic_graph_op) {from, to, DYNAMIC_GRAPH_INSERT};
+            alive[alive_size++] = (struct edge) {from, to};
+        }
+    }
+
+    free(alive);
+    return alive_size;
+}
+
+// Ingests the inserts by growing a struct graph, i.e. reallocating and copying
+// all edges for every batch. Returns the elapsed seconds.
+double ingest_static(const struct parameters *_parameters, const struct dynamic_graph_op *_ops)
+{
+    const double start = now();
+    struct graph g     = create_graph(_parameters->nodes, 0);
+
+    for (size_t begin = 0; begin < _parameters->ops; begin += _parameters->batch) {
+        const size_t end = begin + _parameters->batch < _parameters->ops ? begin + _parameters->batch : _parameters->ops;
+
+        // Count the inserts of the batch (deletes are ignored)
+        size_t inserts = 0;
+        for (size_t i = begin; i < end; ++i) {
+            inserts += _ops[i].kind == DYNAMIC_GRAPH_INSERT;
+        }
+
+        // Copy the whole graph into a larger one
+        struct graph larger = create_graph(_parameters->nodes, g.edges_size + inserts);
+        memcpy(larger.edges, g.edges, sizeof(struct edge) * g.edges_size);
+
+        size_t size = g.edges_size;
+        for (size_t i = begin; i < end; ++i) {
+            if (_ops[i].kind == DYNAMIC_GRAPH_INSERT) {
+                larger.edges[size++] = (struct edge) {_ops[i].from, _ops[i].to};
+            }
+        }
+
+        destroy_graph(g);
+        g = larger;
+    }
+
+    destroy_graph(g);
+    return now() - start;
+}
+
+// Periodically takes snapshots and reads neighbor lists of random nodes.
+void *reader_main(void *_state)
+{
+    struct reader_state *state  = _state;
+    uint64_t             random = 7;
+    size_t               buffer[1024];
+
+    while (!atomic_load(&state->done)) {
+        struct dynamic_graph_snapshot snapshot = dynamic_graph_snapshot(state->graph);
+
+        for (size_t i = 0; i < 16; ++i) {
+            const size_t count = dynamic_graph_neighbors(&snapshot, (size_t) next_random(&random) % state->nodes, buffer, 1024);
+            state->neighbors += count == (size_t) -1 ? 0 : count;
+        }
+
+        dynamic_graph_release(snapshot);
+        ++state->snapshots;
+
+        // Leave CPU time to ingestion and merging
+        const struct timespec pause = {0, 100000};
+        nanosleep(&pause, NULL);
+    }
+
+    return NULL;
+}
+
+// Compares batched ingestion into a dynamic graph with growing a struct graph.
+// Usage: 03_c_benchmark_dynamic_graph [nodes] [changes] [batch size]
+int main(int _argc, char **_argv)
+{
+    struct parameters parameters = {
+        .nodes = _argc > 1 ? strtoull(_argv[1], NULL, 10) : (size_t) 1 << 16,
+        .ops   = _argc > 2 ? strtoull(_argv[2], NULL, 10) : (size_t) 1 << 21,
+        .batch = _argc > 3 ? strtoull(_argv[3], NULL, 10) : (size_t) 4096,
+    };
+
+    if (parameters.nodes == 0 || parameters.batch == 0) {
+        puts("Nodes and batch size have to be positive.");
+        return EXIT_FAILURE;
+    }
+
+    struct dynamic_graph_op *ops = malloc(sizeof(struct dynamic_graph_op) * (parameters.ops + 1));
+    if (ops == NULL) {
+        puts("Could not allocate changes.");
+        return EXIT_FAILURE;
+    }
+
+    const size_t expected_edges = generate_ops(&parameters, ops);
+    printf("nodes: %zu, changes: %zu, batch size: %zu\n", parameters.nodes, parameters.ops, parameters.batch);
+
+    // Baseline
+    const double static_seconds = ingest_static(&parameters, ops);
+    printf("struct graph (copy per batch, inserts only): %.1f M changes/s\n", (double) parameters.ops / static_seconds * 1e-6);
+
+    // Dynamic graph with a concurrent reader
+    struct reader_state reader = {
+        .graph     = create_dynamic_graph(1 << 18),
+        .nodes     = parameters.nodes,
+        .snapshots = 0,
+        .neighbors = 0,
+    };
+    atomic_init(&reader.done, 0);
+
+    if (reader.graph == NULL) {
+        free(ops);
+        puts("Could not create dynamic graph.");
+        return EXIT_FAILURE;
+    }
+
+    pthread_t reader_thread;
+    pthread_create(&reader_thread, NULL, reader_main, &reader);
+
+    const double start = now();
+    for (size_t begin = 0; begin < parameters.ops; begin += parameters.batch) {
+        const size_t size = begin + parameters.batch < parameters.ops ? parameters.batch : parameters.ops - begin;
+        dynamic_graph_apply(reader.graph, ops + begin, size);
+    }
+    const double ingested = now();
+    dynamic_graph_sync(reader.graph);
+    const double merged = now();
+
+    atomic_store(&reader.done, 1);
+    pthread_join(reader_thread, NULL);
+
+    const struct dynamic_graph_stats stats = dynamic_graph_get_stats(reader.graph);
+    printf("dynamic graph ingestion:                     %.1f M changes/s\n", (double) parameters.ops / (ingested - start) * 1e-6);
+    printf("dynamic graph including final merge:         %.1f M changes/s\n", (double) parameters.ops / (merged - start) * 1e-6);
+    printf("background merges: %zu, snapshots read concurrently: %zu\n", stats.merges, reader.snapshots);
+    printf("edges: %zu (expected %zu)\n", stats.base_edges, expected_edges);
+
+    destroy_dynamic_graph(reader.graph);
+    free(ops);
+
+    return stats.base_edges == expected_edges ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,352 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "compressed_graph.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Enable the AVX2 decoder on x86 with GCC or Clang
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#    define COMPRESSED_GRAPH_AVX2
+#    include <immintrin.h>
+#endif
+
+// The number of padding bytes after the last block. Allows decoders to load
+// whole words without checking the end of the data.
+#define COMPRESSED_GRAPH_PADDING 8
+
+// The largest bit width the AVX2 decoder handles (a value plus its bit offset
+// within the first byte has to fit into a 32 bit load).
+#define COMPRESSED_GRAPH_AVX2_MAX_WIDTH 25
+
+// Returns the number of bits required to represent _value.
+static uint32_t bit_width(uint32_t _value)
+{
+    uint32_t width = 0;
+    while (_value != 0) {
+        ++width;
+        _value >>= 1;
+    }
+
+    return width;
+}
+
+// Returns a mask with the lowest _width bits set.
+static uint32_t width_mask(uint32_t _width)
+{
+    return _width == 32 ? UINT32_MAX : (UINT32_C(1) << _width) - 1;
+}
+
+// Compares two uint32_t values, used for qsort.
+static int compare_uint32(const void *_a, const void *_b)
+{
+    const uint32_t a = *(const uint32_t *) _a;
+    const uint32_t b = *(const uint32_t *) _b;
+
+    return (a > b) - (a < b);
+}
+
+// Computes the differences of the block starting at _neighbors[_begin] and
+// returns the bit width of the block. Missing values are filled with 0.
+static uint32_t block_deltas(const uint32_t *_neighbors, uint32_t _degree, uint32_t _begin, uint32_t *_deltas)
+{
+    uint32_t width = 0;
+
+    for (uint32_t i = 0; i < COMPRESSED_GRAPH_BLOCK_SIZE; ++i) {
+        const uint32_t index = _begin + i;
+
+        if (index < _degree) {
+            _deltas[i] = _neighbors[index] - (index == 0 ? 0 : _neighbors[index - 1]);
+        } else {
+            _deltas[i] = 0;
+        }
+
+        const uint32_t w = bit_width(_deltas[i]);
+        width            = w > width ? w : width;
+    }
+
+    return width;
+}
+
+// Returns the number of bytes needed to encode a sorted neighbor list.
+static size_t encoded_size(const uint32_t *_neighbors, uint32_t _degree)
+{
+    size_t   size = 0;
+    uint32_t deltas[COMPRESSED_GRAPH_BLOCK_SIZE];
+
+    for (uint32_t begin = 0; begin < _degree; begin += COMPRESSED_GRAPH_BLOCK_SIZE) {
+        size += 1 + block_deltas(_neighbors, _degree, begin, deltas);
+    }
+
+    return size;
+}
+
+// Encodes a sorted neighbor list into zero initialized memory at _out.
+static void encode(const uint32_t *_neighbors, uint32_t _degree, uint8_t *_out)
+{
+    uint32_t deltas[COMPRESSED_GRAPH_BLOCK_SIZE];
+
+    for (uint32_t begin = 0; begin < _degree; begin += COMPRESSED_GRAPH_BLOCK_SIZE) {
+        const uint32_t width = block_deltas(_neighbors, _degree, begin, deltas);
+
+        // Write the header
+        *_out++ = (uint8_t) width;
+
+        // Pack the values, least significant bit first
+        for (uint32_t i = 0; i < COMPRESSED_GRAPH_BLOCK_SIZE; ++i) {
+            const size_t bit   = (size_t) i * width;
+            uint64_t     value = (uint64_t) deltas[i] << (bit & 7);
+
+            for (uint8_t *iter = _out + (bit >> 3); value != 0; ++iter, value >>= 8) {
+                *iter |= (uint8_t) value;
+            }
+        }
+
+        _out += width;
+    }
+}
+
+// Decodes a block using portable code. Returns the next block.
+static const uint8_t *decode_block_scalar(const uint8_t *_in, uint32_t *_base, uint32_t *_out)
+{
+    const uint32_t width = _in[0];
+    const uint32_t mask  = width_mask(width);
+
+    for (uint32_t i = 0; i < COMPRESSED_GRAPH_BLOCK_SIZE; ++i) {
+        const size_t bit = (size_t) i * width;
+
+        // Load 8 bytes containing the value (little endian)
+        uint64_t word;
+        memcpy(&word, _in + 1 + (bit >> 3), sizeof(word));
+
+        *_base += (uint32_t) (word >> (bit & 7)) & mask;
+        _out[i] = *_base;
+    }
+
+    return _in + 1 + width;
+}
+
+#ifdef COMPRESSED_GRAPH_AVX2
+
+// Decodes a block using AVX2. Returns the next block.
+__attribute__((target("avx2"))) static const uint8_t *decode_block_avx2(const uint8_t *_in, uint32_t *_base, uint32_t *_out)
+{
+    const uint32_t width = _in[0];
+
+    // Wide values do not fit into a single 32 bit load per lane
+    if (width > COMPRESSED_GRAPH_AVX2_MAX_WIDTH) {
+        return decode_block_scalar(_in, _base, _out);
+    }
+
+    // Compute the byte offset and the shift of every value
+    const __m256i lanes  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i bits   = _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int) width));
+    const __m256i bytes  = _mm256_srli_epi32(bits, 3);
+    const __m256i shifts = _mm256_and_si256(bits, _mm256_set1_epi32(7));
+
+    // Load, shift and mask the values
+    __m256i values = _mm256_i32gather_epi32((const int *) (const void *) (_in + 1), bytes, 1);
+    values         = _mm256_srlv_epi32(values, shifts);
+    values         = _mm256_and_si256(values, _mm256_set1_epi32((int) width_mask(width)));
+
+    // Inclusive prefix sum within both 128 bit halves ...
+    values = _mm256_add_epi32(values, _mm256_slli_si256(values, 4));
+    values = _mm256_add_epi32(values, _mm256_slli_si256(values, 8));
+
+    // ... then carry the last value of the lower half into the upper half
+    const __m256i carry = _mm256_permutevar8x32_epi32(values, _mm256_set1_epi32(3));
+    values              = _mm256_add_epi32(values, _mm256_blend_epi32(_mm256_setzero_si256(), carry, 0xF0));
+
+    // Add the last neighbor of the previous block
+    values = _mm256_add_epi32(values, _mm256_set1_epi32((int) *_base));
+
+    _mm256_storeu_si256((__m256i *) (void *) _out, values);
+    *_base = (uint32_t) _mm256_extract_epi32(values, 7);
+
+    return _in + 1 + width;
+}
+
+#endif
+
+struct compressed_graph compress_graph(const struct graph *_graph)
+{
+    // Initialize an empty result, returned on failure
+    struct compressed_graph ret = {
+        .nodes_size = 0,
+        .edges_size = 0,
+        .degrees    = NULL,
+        .offsets    = NULL,
+        .data       = NULL,
+        .data_size  = 0,
+    };
+
+    // Node indices have to fit into 32 bits
+    if (_graph->nodes_size > UINT32_MAX) {
+        return ret;
+    }
+
+    const uint32_t nodes = (uint32_t) _graph->nodes_size;
+
+    // Allocate the result arrays and temporary buffers
+    uint32_t *degrees   = calloc((size_t) nodes + 1, sizeof(uint32_t));
+    uint64_t *offsets   = calloc((size_t) nodes + 1, sizeof(uint64_t));
+    size_t   *starts    = calloc((size_t) nodes + 1, sizeof(size_t));
+    uint32_t *neighbors = malloc(sizeof(uint32_t) * (_graph->edges_size + 1));
+    uint8_t  *data      = NULL;
+
+    if (degrees == NULL || offsets == NULL || starts == NULL || neighbors == NULL) {
+        goto cleanup;
+    }
+
+    // Count the degrees while validating the edges
+    for (size_t i = 0; i < _graph->edges_size; ++i) {
+        const struct edge *e = &_graph->edges[i];
+
+        if (e->from >= nodes || e->to >= nodes || degrees[e->from] == UINT32_MAX) {
+            goto cleanup;
+        }
+
+        ++degrees[e->from];
+    }
+
+    // Compute where the neighbors of every node start
+    for (uint32_t i = 0; i < nodes; ++i) {
+        starts[i + 1] = starts[i] + degrees[i];
+    }
+
+    // Distribute the neighbors (starts is advanced and restored afterwards)
+    for (size_t i = 0; i < _graph->edges_size; ++i) {
+        const struct edge *e        = &_graph->edges[i];
+        neighbors[starts[e->from]++] = (uint32_t) e->to;
+    }
+
+    for (uint32_t i = nodes; i > 0; --i) {
+        starts[i] = starts[i - 1];
+    }
+    starts[0] = 0;
+
+    // Sort every neighbor list and compute the encoded sizes
+    for (uint32_t i = 0; i < nodes; ++i) {
+        qsort(neighbors + starts[i], degrees[i], sizeof(uint32_t), compare_uint32);
+        offsets[i + 1] = offsets[i] + encoded_size(neighbors + starts[i], degrees[i]);
+    }
+
+    // Encode the neighbor lists
+    data = calloc(offsets[nodes] + COMPRESSED_GRAPH_PADDING, 1);
+    if (data == NULL) {
+        goto cleanup;
+    }
+
+    for (uint32_t i = 0; i < nodes; ++i) {
+        encode(neighbors + starts[i], degrees[i], data + offsets[i]);
+    }
+
+    // Transfer ownership to the result
+    ret.nodes_size = nodes;
+    ret.edges_size = _graph->edges_size;
+    ret.degrees    = degrees;
+    ret.offsets    = offsets;
+    ret.data       = data;
+    ret.data_size  = offsets[nodes];
+    degrees        = NULL;
+    offsets        = NULL;
+    data           = NULL;
+
+cleanup:
+    // Free everything not owned by the result
+    free(degrees);
+    free(offsets);
+    free(starts);
+    free(neighbors);
+    free(data);
+
+    return ret;
+}
+
+void destroy_compressed_graph(struct compressed_graph _graph)
+{
+    free(_graph.degrees);
+    free(_graph.offsets);
+    free(_graph.data);
+}
+
+int compressed_graph_has_avx2(void)
+{
+#ifdef COMPRESSED_GRAPH_AVX2
+    return __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+uint32_t compressed_graph_neighbors(const struct compressed_graph *_graph, uint32_t _node, uint32_t *_out, enum compressed_graph_decoder _decoder)
+{
+    const uint32_t degree = _graph->degrees[_node];
+    const uint8_t *in     = _graph->data + _graph->offsets[_node];
+    uint32_t       base   = 0;
+
+#ifdef COMPRESSED_GRAPH_AVX2
+    // Use AVX2 if requested (or automatically chosen) and available
+    if (_decoder != COMPRESSED_GRAPH_DECODER_SCALAR && compressed_graph_has_avx2()) {
+        for (uint32_t i = 0; i < degree; i += COMPRESSED_GRAPH_BLOCK_SIZE) {
+            in = decode_block_avx2(in, &base, _out + i);
+        }
+
+        return degree;
+    }
+#else
+    (void) _decoder;
+#endif
+
+    for (uint32_t i = 0; i < degree; i += COMPRESSED_GRAPH_BLOCK_SIZE) {
+        in = decode_block_scalar(in, &base, _out + i);
+    }
+
+    return degree;
+}
+
+size_t compressed_graph_bytes(const struct compressed_graph *_graph)
+{
+    return sizeof(*_graph) + (sizeof(uint32_t) + sizeof(uint64_t)) * _graph->nodes_size + sizeof(uint64_t) + _graph->data_size + COMPRESSED_GRAPH_PADDING;
+}
+
+double compressed_graph_ratio(const struct graph *_graph, const struct compressed_graph *_compressed)
+{
+    return (double) (sizeof(struct edge) * _graph->edges_size) / (double) compressed_graph_bytes(_compressed);
+}
+
+double compressed_graph_decode_throughput(const struct compressed_graph *_graph, enum compressed_graph_decoder _decoder, size_t _rounds)
+{
+    // Find the largest degree to size the buffer
+    uint32_t max_degree = 0;
+    for (uint32_t i = 0; i < _graph->nodes_size; ++i) {
+        max_degree = _graph->degrees[i] > max_degree ? _graph->degrees[i] : max_degree;
+    }
+
+    uint32_t *buffer = malloc(sizeof(uint32_t) * (COMPRESSED_GRAPH_BUFFER_SIZE((size_t) max_degree) + 1));
+    if (buffer == NULL) {
+        return -1.;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Decode every list and touch the result to keep the work observable
+    volatile uint32_t checksum = 0;
+    for (size_t round = 0; round < _rounds; ++round) {
+        for (uint32_t i = 0; i < _graph->nodes_size; ++i) {
+            const uint32_t degree = compressed_graph_neighbors(_graph, i, buffer, _decoder);
+            if (degree != 0) {
+                checksum = checksum + buffer[degree - 1];
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(buffer);
+
+    const double seconds = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) * 1e-9;
+    return (double) (_graph->edges_size * _rounds) / seconds;
+}
@@ -0,0 +1,107 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "graph.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The number of neighbors stored per block.
+#define COMPRESSED_GRAPH_BLOCK_SIZE 8
+
+// The number of elements a buffer passed to compressed_graph_neighbors() needs
+// for a node with a given degree (decoding always writes whole blocks).
+#define COMPRESSED_GRAPH_BUFFER_SIZE(_degree) \
+    (((_degree) + COMPRESSED_GRAPH_BLOCK_SIZE - 1) / COMPRESSED_GRAPH_BLOCK_SIZE * COMPRESSED_GRAPH_BLOCK_SIZE)
+
+/**
+ * A compressed, read-only adjacency representation of a graph. The neighbors of
+ * every node are sorted and stored as differences to their predecessor (the
+ * first one relative to 0). The differences are grouped into blocks of
+ * COMPRESSED_GRAPH_BLOCK_SIZE values. A block starts with one byte holding the
+ * bit width w (0 to 32) of its largest difference, followed by the values
+ * packed into w bytes (8 values times w bits, least significant bit first).
+ */
+struct compressed_graph {
+    uint32_t  nodes_size;
+    size_t    edges_size;
+    uint32_t *degrees;
+    uint64_t *offsets;
+    uint8_t  *data;
+    size_t    data_size;
+};
+
+// The available block decoders.
+enum compressed_graph_decoder {
+    // Use the fastest decoder supported by the CPU.
+    COMPRESSED_GRAPH_DECODER_AUTO,
+
+    // Portable decoder.
+    COMPRESSED_GRAPH_DECODER_SCALAR,
+
+    // AVX2 decoder, falls back to the scalar decoder if AVX2 is unavailable.
+    COMPRESSED_GRAPH_DECODER_AVX2
+};
+
+/**
+ * This function allocates memory and transfers ownership to the caller. To free
+ * the memory use destroy_compressed_graph().
+ *
+ * @param _graph The graph that will be compressed. Node indices have to fit
+ * into 32 bits and edges have to point to existing nodes.
+ * @return A compressed copy of the edges of _graph. If the allocation failed or
+ * _graph cannot be represented all arrays are NULL and the sizes are set to 0.
+ */
+struct compressed_graph compress_graph(const struct graph *_graph);
+
+/**
+ * This function deallocates memory associated with a graph object obtained by
+ * calling compress_graph().
+ *
+ * @param _graph The graph that will be destroyed.
+ */
+void destroy_compressed_graph(struct compressed_graph _graph);
+
+/**
+ * Decodes the sorted neighbors of a node.
+ *
+ * @param _graph The compressed graph.
+ * @param _node The node whose neighbors are decoded.
+ * @param _out The buffer receiving the neighbors. Has to hold at least
+ * COMPRESSED_GRAPH_BUFFER_SIZE(degree) elements.
+ * @param _decoder The decoder that is used.
+ * @return The number of neighbors, i.e. the degree of the node.
+ */
+uint32_t compressed_graph_neighbors(const struct compressed_graph *_graph, uint32_t _node, uint32_t *_out, enum compressed_graph_decoder _decoder);
+
+/**
+ * @return Non-zero if the AVX2 decoder can be used on this CPU.
+ */
+int compressed_graph_has_avx2(void);
+
+/**
+ * @param _graph The compressed graph.
+ * @return The number of bytes used by the compressed graph.
+ */
+size_t compressed_graph_bytes(const struct compressed_graph *_graph);
+
+/**
+ * @param _graph The original graph.
+ * @param _compressed The compressed version of _graph.
+ * @return The size of the edge array of _graph divided by the size of
+ * _compressed.
+ */
+double compressed_graph_ratio(const struct graph *_graph, const struct compressed_graph *_compressed);
+
+/**
+ * Decodes all neighbor lists _rounds times and measures the throughput.
+ *
+ * @param _graph The compressed graph.
+ * @param _decoder The decoder that is used.
+ * @param _rounds The number of passes over the graph.
+ * @return The number of decoded edges per second or a negative number if
+ * memory for the decoding buffer could not be allocated.
+ */
+double compressed_graph_decode_throughput(const struct compressed_graph *_graph, enum compressed_graph_decoder _decoder, size_t _rounds);
@@ -0,0 +1,737 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "dynamic_graph.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// The number of changes stored per log chunk.
+#define DYNAMIC_GRAPH_CHUNK_SIZE 4096
+
+// The compact, immutable adjacency arrays (compressed sparse rows). The
+// targets of every node are sorted.
+struct dynamic_graph_base {
+    atomic_size_t references;
+    size_t        nodes_size;
+    size_t        edges_size;
+    size_t       *offsets;
+    size_t       *targets;
+};
+
+// A change stored in a log. The entries with the same source are linked from
+// the latest to the earliest one.
+struct dynamic_graph_entry {
+    struct dynamic_graph_op           op;
+    size_t                            index;
+    const struct dynamic_graph_entry *previous;
+};
+
+// A part of a log.
+struct dynamic_graph_chunk {
+    struct dynamic_graph_chunk *next;
+    struct dynamic_graph_entry  entries[DYNAMIC_GRAPH_CHUNK_SIZE];
+};
+
+// The latest entry of a log per source node. When it has to grow, a larger
+// copy is published and the old table is kept until the log is freed, since
+// snapshots may still read it.
+struct dynamic_graph_heads {
+    struct dynamic_graph_heads                 *retired;
+    size_t                                      nodes_size;
+    _Atomic(const struct dynamic_graph_entry *) latest[];
+};
+
+// An append-only list of changes. Entries below size are never modified, so
+// snapshots can read them without locking.
+struct dynamic_graph_log {
+    atomic_size_t                        references;
+    struct dynamic_graph_chunk          *head;
+    struct dynamic_graph_chunk          *tail;
+    size_t                               size;
+    _Atomic(struct dynamic_graph_heads *) heads;
+};
+
+struct dynamic_graph {
+    // Protects all members below
+    pthread_mutex_t mutex;
+
+    // Signals the merger that there is work or it should stop
+    pthread_cond_t work;
+
+    // Signals waiting threads that a merge completed
+    pthread_cond_t merged;
+
+    // The merger thread
+    pthread_t merger;
+
+    // The state visible to snapshots
+    size_t                     nodes_size;
+    struct dynamic_graph_base *base;
+    struct dynamic_graph_log  *pending;
+    size_t                     pending_size;
+    struct dynamic_graph_log  *current;
+
+    // Merge configuration and bookkeeping
+    size_t merge_threshold;
+    size_t merges;
+    int    sync_requested;
+    int    stop;
+};
+
+// A change together with its position in the log.
+struct sequenced_op {
+    size_t                     from;
+    size_t                     to;
+    size_t                     sequence;
+    enum dynamic_graph_op_kind kind;
+};
+
+// Allocates an empty base with _nodes nodes.
+static struct dynamic_graph_base *create_base(size_t _nodes, size_t _edges)
+{
+    struct dynamic_graph_base *ret = malloc(sizeof(struct dynamic_graph_base));
+    if (ret == NULL) {
+        return NULL;
+    }
+
+    atomic_init(&ret->references, 1);
+    ret->nodes_size = _nodes;
+    ret->edges_size = 0;
+    ret->offsets    = calloc(_nodes + 1, sizeof(size_t));
+    ret->targets    = malloc(sizeof(size_t) * (_edges + 1));
+
+    if (ret->offsets == NULL || ret->targets == NULL) {
+        free(ret->offsets);
+        free(ret->targets);
+        free(ret);
+        return NULL;
+    }
+
+    return ret;
+}
+
+// Drops a reference to a base and frees it if it was the last one.
+static void release_base(struct dynamic_graph_base *_base)
+{
+    if (_base != NULL && atomic_fetch_sub(&_base->references, 1) == 1) {
+        free(_base->offsets);
+        free(_base->targets);
+        free(_base);
+    }
+}
+
+// Allocates an empty log.
+static struct dynamic_graph_log *create_log(void)
+{
+    struct dynamic_graph_log *ret = malloc(sizeof(struct dynamic_graph_log));
+    if (ret == NULL) {
+        return NULL;
+    }
+
+    atomic_init(&ret->references, 1);
+    atomic_init(&ret->heads, NULL);
+    ret->head = NULL;
+    ret->tail = NULL;
+    ret->size = 0;
+
+    return ret;
+}
+
+// Drops a reference to a log and frees it if it was the last one.
+static void release_log(struct dynamic_graph_log *_log)
+{
+    if (_log == NULL || atomic_fetch_sub(&_log->references, 1) != 1) {
+        return;
+    }
+
+    while (_log->head != NULL) {
+        struct dynamic_graph_chunk *next = _log->head->next;
+        free(_log->head);
+        _log->head = next;
+    }
+
+    struct dynamic_graph_heads *heads = atomic_load_explicit(&_log->heads, memory_order_relaxed);
+    while (heads != NULL) {
+        struct dynamic_graph_heads *retired = heads->retired;
+        free(heads);
+        heads = retired;
+    }
+
+    free(_log);
+}
+
+// Makes sure the heads of a log cover the sources below _nodes. Returns 0 if
+// the allocation failed. The mutex of the graph has to be locked.
+static int reserve_heads(struct dynamic_graph_log *_log, size_t _nodes)
+{
+    struct dynamic_graph_heads *old = atomic_load_explicit(&_log->heads, memory_order_relaxed);
+    if (old != NULL && old->nodes_size >= _nodes) {
+        return 1;
+    }
+
+    // Grow geometrically to keep the copies amortized
+    const size_t nodes = old != NULL && 2 * old->nodes_size > _nodes ? 2 * old->nodes_size : _nodes;
+
+    struct dynamic_graph_heads *ret = malloc(sizeof(struct dynamic_graph_heads) + sizeof(ret->latest[0]) * nodes);
+    if (ret == NULL) {
+        return 0;
+    }
+
+    ret->retired    = old;
+    ret->nodes_size = nodes;
+    for (size_t node = 0; node < nodes; ++node) {
+        atomic_init(&ret->latest[node], old != NULL && node < old->nodes_size ? atomic_load_explicit(&old->latest[node], memory_order_relaxed) : NULL);
+    }
+
+    atomic_store_explicit(&_log->heads, ret, memory_order_release);
+    return 1;
+}
+
+// Returns the change at position _index of a log.
+static const struct dynamic_graph_op *log_at(const struct dynamic_graph_chunk **_chunk, size_t _index)
+{
+    // Advance to the next chunk at chunk boundaries
+    if (_index != 0 && _index % DYNAMIC_GRAPH_CHUNK_SIZE == 0) {
+        *_chunk = (*_chunk)->next;
+    }
+
+    return &(*_chunk)->entries[_index % DYNAMIC_GRAPH_CHUNK_SIZE].op;
+}
+
+// Orders changes by source, target and position in the log.
+static int compare_sequenced_op(const void *_a, const void *_b)
+{
+    const struct sequenced_op *a = _a;
+    const struct sequenced_op *b = _b;
+
+    if (a->from != b->from) {
+        return (a->from > b->from) - (a->from < b->from);
+    }
+
+    if (a->to != b->to) {
+        return (a->to > b->to) - (a->to < b->to);
+    }
+
+    return (a->sequence > b->sequence) - (a->sequence < b->sequence);
+}
+
+// Orders size_t values, used for qsort.
+static int compare_size(const void *_a, const void *_b)
+{
+    const size_t a = *(const size_t *) _a;
+    const size_t b = *(const size_t *) _b;
+
+    return (a > b) - (a < b);
+}
+
+// Creates a new base by applying the first _size changes of _log to _base.
+// Returns NULL if the allocation failed.
+static struct dynamic_graph_base *merge(const struct dynamic_graph_base *_base, const struct dynamic_graph_log *_log, size_t _size)
+{
+    // Determine the number of nodes and count the changes per source
+    const struct dynamic_graph_chunk *chunk   = _log->head;
+    size_t                            nodes   = _base->nodes_size;
+    size_t                            inserts = 0;
+    for (size_t i = 0; i < _size; ++i) {
+        const struct dynamic_graph_op *op = log_at(&chunk, i);
+
+        nodes = op->from >= nodes ? op->from + 1 : nodes;
+        nodes = op->to >= nodes ? op->to + 1 : nodes;
+        inserts += op->kind == DYNAMIC_GRAPH_INSERT;
+    }
+
+    struct sequenced_op *ops    = malloc(sizeof(struct sequenced_op) * (_size + 1));
+    size_t              *starts = calloc(nodes + 1, sizeof(size_t));
+    if (ops == NULL || starts == NULL) {
+        free(ops);
+        free(starts);
+        return NULL;
+    }
+
+    chunk = _log->head;
+    for (size_t i = 0; i < _size; ++i) {
+        ++starts[log_at(&chunk, i)->from + 1];
+    }
+
+    for (size_t node = 0; node < nodes; ++node) {
+        starts[node + 1] += starts[node];
+    }
+
+    // Distribute the changes by source (counting sort, keeps the log order),
+    // then sort the changes of every source by target and sequence
+    chunk = _log->head;
+    for (size_t i = 0; i < _size; ++i) {
+        const struct dynamic_graph_op *op = log_at(&chunk, i);
+        ops[starts[op->from]++]           = (struct sequenced_op) {op->from, op->to, i, op->kind};
+    }
+
+    for (size_t node = 0, begin = 0; node < nodes; begin = starts[node++]) {
+        qsort(ops + begin, starts[node] - begin, sizeof(struct sequenced_op), compare_sequenced_op);
+    }
+
+    free(starts);
+
+    // Allocate for the worst case, i.e. no delete removes anything
+    struct dynamic_graph_base *ret = create_base(nodes, _base->edges_size + inserts);
+    if (ret == NULL) {
+        free(ops);
+        return NULL;
+    }
+
+    // Merge the sorted targets of every node with its sorted changes
+    size_t op_index = 0;
+    for (size_t node = 0; node < nodes; ++node) {
+        size_t       base_index = node < _base->nodes_size ? _base->offsets[node] : 0;
+        const size_t base_end   = node < _base->nodes_size ? _base->offsets[node + 1] : 0;
+
+        while (base_index < base_end || (op_index < _size && ops[op_index].from == node)) {
+            // Pick the smallest remaining target
+            size_t target = SIZE_MAX;
+            if (base_index < base_end) {
+                target = _base->targets[base_index];
+            }
+            if (op_index < _size && ops[op_index].from == node && ops[op_index].to < target) {
+                target = ops[op_index].to;
+            }
+
+            // Count the occurrences in the base ...
+            size_t count = 0;
+            while (base_index < base_end && _base->targets[base_index] == target) {
+                ++count;
+                ++base_index;
+            }
+
+            // ... and apply the changes in the order they were logged
+            while (op_index < _size && ops[op_index].from == node && ops[op_index].to == target) {
+                if (ops[op_index].kind == DYNAMIC_GRAPH_INSERT) {
+                    ++count;
+                } else if (count != 0) {
+                    --count;
+                }
+                ++op_index;
+            }
+
+            while (count-- != 0) {
+                ret->targets[ret->edges_size++] = target;
+            }
+        }
+
+        ret->offsets[node + 1] = ret->edges_size;
+    }
+
+    free(ops);
+    return ret;
+}
+
+// Waits up to 10 ms for a signal. The mutex has to be locked.
+static void wait_briefly(struct dynamic_graph *_graph)
+{
+    struct timespec timeout;
+    clock_gettime(CLOCK_REALTIME, &timeout);
+
+    timeout.tv_nsec += 10000000;
+    timeout.tv_sec += timeout.tv_nsec / 1000000000;
+    timeout.tv_nsec %= 1000000000;
+
+    pthread_cond_timedwait(&_graph->work, &_graph->mutex, &timeout);
+}
+
+// Waits for work and merges the pending log into the base.
+static void *merger_main(void *_graph)
+{
+    struct dynamic_graph *graph = _graph;
+
+    pthread_mutex_lock(&graph->mutex);
+    for (;;) {
+        // Wait until there is enough work or a sync/stop was requested
+        while (!graph->stop && graph->pending == NULL && graph->current->size < graph->merge_threshold && !(graph->sync_requested && graph->current->size != 0)) {
+            if (graph->sync_requested) {
+                // Nothing to merge, wake up waiting threads
+                graph->sync_requested = 0;
+                pthread_cond_broadcast(&graph->merged);
+            }
+            pthread_cond_wait(&graph->work, &graph->mutex);
+        }
+
+        if (graph->stop) {
+            break;
+        }
+
+        // Seal the current log and start a new one for ingestion
+        if (graph->pending == NULL) {
+            struct dynamic_graph_log *fresh = create_log();
+            if (fresh != NULL) {
+                graph->pending      = graph->current;
+                graph->pending_size = graph->current->size;
+                graph->current      = fresh;
+            }
+        }
+
+        // Retry later if memory is exhausted
+        if (graph->pending == NULL) {
+            wait_briefly(graph);
+            continue;
+        }
+
+        struct dynamic_graph_base *base    = graph->base;
+        struct dynamic_graph_log  *pending = graph->pending;
+        const size_t               size    = graph->pending_size;
+        atomic_fetch_add(&base->references, 1);
+
+        // Build the new base without holding the lock
+        pthread_mutex_unlock(&graph->mutex);
+        struct dynamic_graph_base *merged = merge(base, pending, size);
+        release_base(base);
+        pthread_mutex_lock(&graph->mutex);
+
+        // Retry later if memory is exhausted
+        if (merged == NULL) {
+            wait_briefly(graph);
+            continue;
+        }
+
+        // Publish the new base and drop the merged log
+        release_base(graph->base);
+        release_log(graph->pending);
+        graph->base         = merged;
+        graph->pending      = NULL;
+        graph->pending_size = 0;
+        ++graph->merges;
+
+        pthread_cond_broadcast(&graph->merged);
+    }
+    pthread_mutex_unlock(&graph->mutex);
+
+    return NULL;
+}
+
+struct dynamic_graph *create_dynamic_graph(size_t _merge_threshold)
+{
+    struct dynamic_graph *ret = malloc(sizeof(struct dynamic_graph));
+    if (ret == NULL) {
+        return NULL;
+    }
+
+    ret->nodes_size      = 0;
+    ret->base            = create_base(0, 0);
+    ret->pending         = NULL;
+    ret->pending_size    = 0;
+    ret->current         = create_log();
+    ret->merge_threshold = _merge_threshold == 0 ? 1 : _merge_threshold;
+    ret->merges          = 0;
+    ret->sync_requested  = 0;
+    ret->stop            = 0;
+
+    if (ret->base == NULL || ret->current == NULL) {
+        release_base(ret->base);
+        release_log(ret->current);
+        free(ret);
+        return NULL;
+    }
+
+    pthread_mutex_init(&ret->mutex, NULL);
+    pthread_cond_init(&ret->work, NULL);
+    pthread_cond_init(&ret->merged, NULL);
+
+    if (pthread_create(&ret->merger, NULL, merger_main, ret) != 0) {
+        pthread_cond_destroy(&ret->merged);
+        pthread_cond_destroy(&ret->work);
+        pthread_mutex_destroy(&ret->mutex);
+        release_base(ret->base);
+        release_log(ret->current);
+        free(ret);
+        return NULL;
+    }
+
+    return ret;
+}
+
+void destroy_dynamic_graph(struct dynamic_graph *_graph)
+{
+    if (_graph == NULL) {
+        return;
+    }
+
+    // Stop the merger
+    pthread_mutex_lock(&_graph->mutex);
+    _graph->stop = 1;
+    pthread_cond_signal(&_graph->work);
+    pthread_mutex_unlock(&_graph->mutex);
+    pthread_join(_graph->merger, NULL);
+
+    pthread_cond_destroy(&_graph->merged);
+    pthread_cond_destroy(&_graph->work);
+    pthread_mutex_destroy(&_graph->mutex);
+
+    release_base(_graph->base);
+    release_log(_graph->pending);
+    release_log(_graph->current);
+    free(_graph);
+}
+
+int dynamic_graph_apply(struct dynamic_graph *_graph, const struct dynamic_graph_op *_ops, size_t _count)
+{
+    pthread_mutex_lock(&_graph->mutex);
+
+    struct dynamic_graph_log *log = _graph->current;
+
+    // Make room for the heads first so a failure leaves the log unchanged
+    size_t sources = 0;
+    for (size_t i = 0; i < _count; ++i) {
+        sources = _ops[i].from >= sources ? _ops[i].from + 1 : sources;
+    }
+
+    if (!reserve_heads(log, sources)) {
+        pthread_mutex_unlock(&_graph->mutex);
+        return 0;
+    }
+
+    // Allocate all chunks first so a failure leaves the log unchanged
+    const size_t free_slots = log->tail == NULL ? 0 : DYNAMIC_GRAPH_CHUNK_SIZE - (log->size - 1) % DYNAMIC_GRAPH_CHUNK_SIZE - 1;
+    const size_t needed     = _count > free_slots ? (_count - free_slots + DYNAMIC_GRAPH_CHUNK_SIZE - 1) / DYNAMIC_GRAPH_CHUNK_SIZE : 0;
+
+    struct dynamic_graph_chunk *first = NULL;
+    struct dynamic_graph_chunk *last  = NULL;
+    for (size_t i = 0; i < needed; ++i) {
+        struct dynamic_graph_chunk *chunk = malloc(sizeof(struct dynamic_graph_chunk));
+        if (chunk == NULL) {
+            while (first != NULL) {
+                struct dynamic_graph_chunk *next = first->next;
+                free(first);
+                first = next;
+            }
+            pthread_mutex_unlock(&_graph->mutex);
+            return 0;
+        }
+
+        chunk->next = NULL;
+        if (last == NULL) {
+            first = chunk;
+        } else {
+            last->next = chunk;
+        }
+        last = chunk;
+    }
+
+    // Link the new chunks
+    if (first != NULL) {
+        if (log->tail == NULL) {
+            log->head = first;
+        } else {
+            log->tail->next = first;
+        }
+    }
+
+    // Append the changes (only entries above log->size are written, snapshots
+    // only reach them through the heads and skip them)
+    struct dynamic_graph_heads *heads = atomic_load_explicit(&log->heads, memory_order_relaxed);
+    struct dynamic_graph_chunk *chunk = log->tail == NULL ? first : log->tail;
+    for (size_t i = 0; i < _count; ++i) {
+        const size_t index = log->size + i;
+
+        if (index != 0 && index % DYNAMIC_GRAPH_CHUNK_SIZE == 0) {
+            chunk = chunk->next;
+        }
+
+        // Link the entry to the previous change of its source, then publish it
+        struct dynamic_graph_entry *entry = &chunk->entries[index % DYNAMIC_GRAPH_CHUNK_SIZE];
+        entry->op                         = _ops[i];
+        entry->index                      = index;
+        entry->previous                   = atomic_load_explicit(&heads->latest[_ops[i].from], memory_order_relaxed);
+        atomic_store_explicit(&heads->latest[_ops[i].from], entry, memory_order_release);
+
+        const size_t max_node = _ops[i].from > _ops[i].to ? _ops[i].from : _ops[i].to;
+        _graph->nodes_size    = max_node >= _graph->nodes_size ? max_node + 1 : _graph->nodes_size;
+    }
+
+    if (last != NULL) {
+        log->tail = last;
+    }
+    log->size += _count;
+
+    // Wake up the merger if there is enough work
+    if (log->size >= _graph->merge_threshold) {
+        pthread_cond_signal(&_graph->work);
+    }
+
+    pthread_mutex_unlock(&_graph->mutex);
+    return 1;
+}
+
+int dynamic_graph_insert_edges(struct dynamic_graph *_graph, const struct edge *_edges, size_t _count)
+{
+    struct dynamic_graph_op ops[256];
+
+    // Convert in batches to avoid a temporary allocation. Each batch becomes
+    // visible atomically.
+    for (size_t begin = 0; begin < _count; begin += 256) {
+        const size_t size = _count - begin < 256 ? _count - begin : 256;
+
+        for (size_t i = 0; i < size; ++i) {
+            ops[i] = (struct dynamic_graph_op) {_edges[begin + i].from, _edges[begin + i].to, DYNAMIC_GRAPH_INSERT};
+        }
+
+        if (!dynamic_graph_apply(_graph, ops, size)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+void dynamic_graph_sync(struct dynamic_graph *_graph)
+{
+    pthread_mutex_lock(&_graph->mutex);
+
+    while (_graph->pending != NULL || _graph->current->size != 0) {
+        _graph->sync_requested = 1;
+        pthread_cond_signal(&_graph->work);
+        pthread_cond_wait(&_graph->merged, &_graph->mutex);
+    }
+
+    pthread_mutex_unlock(&_graph->mutex);
+}
+
+struct dynamic_graph_stats dynamic_graph_get_stats(struct dynamic_graph *_graph)
+{
+    pthread_mutex_lock(&_graph->mutex);
+
+    struct dynamic_graph_stats ret = {
+        .nodes_size = _graph->nodes_size,
+        .base_edges = _graph->base->edges_size,
+        .logged_ops = _graph->pending_size + _graph->current->size,
+        .merges     = _graph->merges,
+    };
+
+    pthread_mutex_unlock(&_graph->mutex);
+    return ret;
+}
+
+struct dynamic_graph_snapshot dynamic_graph_snapshot(struct dynamic_graph *_graph)
+{
+    pthread_mutex_lock(&_graph->mutex);
+
+    struct dynamic_graph_snapshot ret = {
+        .nodes_size   = _graph->nodes_size,
+        .base         = _graph->base,
+        .pending      = _graph->pending,
+        .pending_size = _graph->pending_size,
+        .current      = _graph->current,
+        .current_size = _graph->current->size,
+    };
+
+    // Keep the referenced data alive
+    atomic_fetch_add(&ret.base->references, 1);
+    atomic_fetch_add(&ret.current->references, 1);
+    if (ret.pending != NULL) {
+        atomic_fetch_add(&ret.pending->references, 1);
+    }
+
+    pthread_mutex_unlock(&_graph->mutex);
+    return ret;
+}
+
+void dynamic_graph_release(struct dynamic_graph_snapshot _snapshot)
+{
+    release_base(_snapshot.base);
+    release_log(_snapshot.pending);
+    release_log(_snapshot.current);
+}
+
+// Returns the latest change of _node among the first _size changes of a log
+// or NULL. Skips changes appended after the snapshot was taken.
+static const struct dynamic_graph_entry *latest_entry(const struct dynamic_graph_log *_log, size_t _size, size_t _node)
+{
+    const struct dynamic_graph_heads *heads = _log == NULL ? NULL : atomic_load_explicit(&_log->heads, memory_order_acquire);
+    if (heads == NULL || _node >= heads->nodes_size) {
+        return NULL;
+    }
+
+    const struct dynamic_graph_entry *ret = atomic_load_explicit(&heads->latest[_node], memory_order_acquire);
+    while (ret != NULL && ret->index >= _size) {
+        ret = ret->previous;
+    }
+
+    return ret;
+}
+
+// Returns the number of changes linked from an entry.
+static size_t count_entries(const struct dynamic_graph_entry *_entry)
+{
+    size_t ret = 0;
+    for (; _entry != NULL; _entry = _entry->previous) {
+        ++ret;
+    }
+
+    return ret;
+}
+
+size_t dynamic_graph_neighbors(const struct dynamic_graph_snapshot *_snapshot, size_t _node, size_t *_out, size_t _capacity)
+{
+    const struct dynamic_graph_base *base       = _snapshot->base;
+    const size_t                     base_begin = _node < base->nodes_size ? base->offsets[_node] : 0;
+    const size_t                     base_end   = _node < base->nodes_size ? base->offsets[_node + 1] : 0;
+
+    // Only visit the logged changes of _node
+    const struct dynamic_graph_entry *pending = latest_entry(_snapshot->pending, _snapshot->pending_size, _node);
+    const struct dynamic_graph_entry *current = latest_entry(_snapshot->current, _snapshot->current_size, _node);
+    const size_t                      changes = count_entries(pending) + count_entries(current);
+
+    // Fast path: no logged changes
+    if (changes == 0) {
+        const size_t size = base_end - base_begin;
+        memcpy(_out, base->targets + base_begin, sizeof(size_t) * (size < _capacity ? size : _capacity));
+        return size;
+    }
+
+    // The changes are linked from the latest one, restore the log order
+    const struct dynamic_graph_entry **ordered = malloc(sizeof(const struct dynamic_graph_entry *) * changes);
+    size_t                            *list    = malloc(sizeof(size_t) * (base_end - base_begin + changes));
+    if (ordered == NULL || list == NULL) {
+        free(ordered);
+        free(list);
+        return (size_t) -1;
+    }
+
+    size_t position = changes;
+    for (; current != NULL; current = current->previous) {
+        ordered[--position] = current;
+    }
+    for (; pending != NULL; pending = pending->previous) {
+        ordered[--position] = pending;
+    }
+
+    // Start with the base and apply the changes in order
+    size_t size = base_end - base_begin;
+    memcpy(list, base->targets + base_begin, sizeof(size_t) * size);
+
+    for (size_t i = 0; i < changes; ++i) {
+        const struct dynamic_graph_op *op = &ordered[i]->op;
+
+        if (op->kind == DYNAMIC_GRAPH_INSERT) {
+            list[size++] = op->to;
+            continue;
+        }
+
+        // Remove one occurrence
+        for (size_t j = 0; j < size; ++j) {
+            if (list[j] == op->to) {
+                list[j] = list[--size];
+                break;
+            }
+        }
+    }
+
+    // Return sorted neighbors like the base does
+    qsort(list, size, sizeof(size_t), compare_size);
+    memcpy(_out, list, sizeof(size_t) * (size < _capacity ? size : _capacity));
+
+    free(ordered);
+    free(list);
+    return size;
+}
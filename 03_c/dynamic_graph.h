@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "graph.h"
+
+#include <stddef.h>
+
+// The kind of a change to a dynamic graph.
+enum dynamic_graph_op_kind {
+    DYNAMIC_GRAPH_INSERT,
+    DYNAMIC_GRAPH_DELETE
+};
+
+// A change to a dynamic graph. Deleting removes one occurrence of the edge if
+// there is any.
+struct dynamic_graph_op {
+    size_t                     from;
+    size_t                     to;
+    enum dynamic_graph_op_kind kind;
+};
+
+// A dynamic graph (opaque). Use the functions below to access it.
+struct dynamic_graph;
+
+// Internal types referenced by snapshots.
+struct dynamic_graph_base;
+struct dynamic_graph_log;
+
+/**
+ * A consistent, read-only view of a dynamic graph. Obtain one by calling
+ * dynamic_graph_snapshot() and release it with dynamic_graph_release(). Taking
+ * and reading snapshots does not block ingestion.
+ */
+struct dynamic_graph_snapshot {
+    size_t                     nodes_size;
+    struct dynamic_graph_base *base;
+    struct dynamic_graph_log  *pending;
+    size_t                     pending_size;
+    struct dynamic_graph_log  *current;
+    size_t                     current_size;
+};
+
+// Statistics about a dynamic graph.
+struct dynamic_graph_stats {
+    size_t nodes_size;
+    size_t base_edges;
+    size_t logged_ops;
+    size_t merges;
+};
+
+/**
+ * This function allocates memory and starts a background thread. Transfers
+ * ownership to the caller. To free the memory use destroy_dynamic_graph().
+ *
+ * Changes are appended to a log. As soon as the log holds at least
+ * _merge_threshold changes, the background thread merges it into the compact
+ * base arrays while new changes go to a fresh log.
+ *
+ * @param _merge_threshold The number of logged changes that trigger a merge.
+ * @return A new, empty graph or NULL if the allocation failed.
+ */
+struct dynamic_graph *create_dynamic_graph(size_t _merge_threshold);
+
+/**
+ * This function stops the background thread and deallocates memory associated
+ * with a graph obtained by calling create_dynamic_graph(). All snapshots have
+ * to be released before.
+ *
+ * @param _graph The graph that will be destroyed.
+ */
+void destroy_dynamic_graph(struct dynamic_graph *_graph);
+
+/**
+ * Appends a batch of changes. The changes become visible atomically to
+ * snapshots taken afterwards. Nodes are created on demand.
+ *
+ * @param _graph The graph.
+ * @param _ops The changes.
+ * @param _count The number of changes.
+ * @return 0 if memory for the log could not be allocated (nothing was
+ * applied), non-zero otherwise.
+ */
+int dynamic_graph_apply(struct dynamic_graph *_graph, const struct dynamic_graph_op *_ops, size_t _count);
+
+/**
+ * Inserts the edges of a static graph, e.g. one obtained by create_graph().
+ *
+ * @param _graph The graph.
+ * @param _edges The edges that are inserted.
+ * @param _count The number of edges.
+ * @return 0 if memory for the log could not be allocated (nothing was
+ * applied), non-zero otherwise.
+ */
+int dynamic_graph_insert_edges(struct dynamic_graph *_graph, const struct edge *_edges, size_t _count);
+
+/**
+ * Waits until all changes applied so far are merged into the base arrays.
+ *
+ * @param _graph The graph.
+ */
+void dynamic_graph_sync(struct dynamic_graph *_graph);
+
+/**
+ * @param _graph The graph.
+ * @return The current statistics of the graph.
+ */
+struct dynamic_graph_stats dynamic_graph_get_stats(struct dynamic_graph *_graph);
+
+/**
+ * Takes a snapshot of the current state. Only holds an internal lock for a
+ * constant amount of time.
+ *
+ * @param _graph The graph.
+ * @return The snapshot, release it using dynamic_graph_release().
+ */
+struct dynamic_graph_snapshot dynamic_graph_snapshot(struct dynamic_graph *_graph);
+
+/**
+ * Releases a snapshot obtained by dynamic_graph_snapshot().
+ *
+ * @param _snapshot The snapshot.
+ */
+void dynamic_graph_release(struct dynamic_graph_snapshot _snapshot);
+
+/**
+ * Determines the sorted neighbors of a node as seen by a snapshot. The logged
+ * changes are indexed by source, so only the changes of _node are visited.
+ *
+ * @param _snapshot The snapshot.
+ * @param _node The node.
+ * @param _out The buffer receiving up to _capacity neighbors.
+ * @param _capacity The number of elements _out can hold.
+ * @return The number of neighbors (may be larger than _capacity) or
+ * (size_t) -1 if temporary memory could not be allocated.
+ */
+size_t dynamic_graph_neighbors(const struct dynamic_graph_snapshot *_snapshot, size_t _node, size_t *_out, size_t _capacity);
@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "graph.h"
+
+#include <stdlib.h>
+
+struct graph create_graph(size_t _nodes, size_t _edges)
+{
+    // Initialize graph struct
+    struct graph ret = {
+        .nodes_size = _nodes,
+        .nodes      = malloc(sizeof(struct node) * _nodes),
+        .edges_size = _edges,
+        .edges      = malloc(sizeof(struct edge) * _edges),
+    };
+
+    // Check if nodes where allocated successfully
+    if (ret.nodes == NULL) {
+        ret.nodes_size = 0;
+    }
+
+    // Check if edges where allocated successfully
+    if (ret.edges == NULL) {
+        ret.edges_size = 0;
+    }
+
+    // Return result
+    return ret;
+}
+
+void destroy_graph(struct graph _graph)
+{
+    free(_graph.nodes);
+    free(_graph.edges);
+}
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stddef.h>
+
+// A node struct with an id
+struct node {
+    int id;
+};
+
+// An edge struct pointing from one element to another
+struct edge {
+    size_t from;
+    size_t to;
+};
+
+// A graph struct with nodes and edges
+struct graph {
+    size_t       nodes_size;
+    struct node *nodes;
+    size_t       edges_size;
+    struct edge *edges;
+};
+
+/**
+ * This function allocates memory and transfers ownership to the caller. To free
+ * the memory use destroy_graph().
+ *
+ * @param _nodes The number of nodes.
+ * @param _edges The number of edges.
+ * @return A new graph with edge and node arrays. Both arrays can be null if the
+ * allocation failed. In those cases the size will be set to 0.
+ */
+struct graph create_graph(size_t _nodes, size_t _edges);
+
+/**
+ * This function deallocates memory associated with a graph object obtained by
+ * calling create_graph().
+ *
+ * @param _graph The graph that will be destroyed.
+ */
+void destroy_graph(struct graph _graph);
@@ -1,6 +1,9 @@
 // SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
 // SPDX-License-Identifier: MIT
 
+#include "graph.h"
+#include "memory_budget.h"
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -105,70 +108,6 @@ void showcase_own_source_function()
     free(a);
 }
 
-// A node struct with an id
-struct node {
-    int id;
-};
-
-// An edge struct pointing from one element to another
-struct edge {
-    size_t from;
-    size_t to;
-};
-
-// A graph struct with nodes and edges
-struct graph {
-    size_t       nodes_size;
-    struct node *nodes;
-    size_t       edges_size;
-    struct edge *edges;
-};
-
-/**
- * This function allocates memory and transfers ownership to the caller. To free
- * the memory use destroy_graph().
- *
- * @param _nodes The number of nodes.
- * @param _edges The number of edges.
- * @return A new graph with edge and node arrays. Both arrays can be null if the
- * allocation failed. In those cases the size will be set to 0.
- */
-struct graph create_graph(size_t _nodes, size_t _edges)
-{
-    // Initialize graph struct
-    struct graph ret = {
-        .nodes_size = _nodes,
-        .nodes      = malloc(sizeof(struct node) * _nodes),
-        .edges_size = _edges,
-        .edges      = malloc(sizeof(struct edge) * _edges),
-    };
-
-    // Check if nodes where allocated successfully
-    if (ret.nodes == NULL) {
-        ret.nodes_size = 0;
-    }
-
-    // Check if edges where allocated successfully
-    if (ret.edges == NULL) {
-        ret.edges_size = 0;
-    }
-
-    // Return result
-    return ret;
-}
-
-/**
- * This function deallocates memory associated with a graph object obtained by
- * calling create_graph().
- *
- * @param _graph The graph that will be destroyed.
- */
-void destroy_graph(struct graph _graph)
-{
-    free(_graph.nodes);
-    free(_graph.edges);
-}
-
 // This function show cases the usage of a self written source and drain
 // function.
 void showcase_own_source_drain_function()
@@ -251,6 +190,68 @@ void showcase_realloc_pitfall()
 
 #pragma GCC diagnostic pop
 
+// A small cache of allocations that can be dropped under memory pressure.
+struct budget_cache {
+    void  *entries[8];
+    size_t size;
+};
+
+// Pressure callback: drops all cached entries.
+void drop_cache(struct memory_budget *_budget, void *_cache)
+{
+    struct budget_cache *cache = _cache;
+
+    printf("  %s exceeded its soft limit, dropping %zu cache entries\n", _budget->name, cache->size);
+    while (cache->size != 0) {
+        budget_free(cache->entries[--cache->size]);
+    }
+}
+
+// This function showcases how a budget lets large requests fail cleanly
+// instead of leaking (compare showcase_realloc_pitfall).
+void showcase_budgeted_realloc()
+{
+    // Header
+    puts("showcase_budgeted_realloc:");
+
+    // A process wide budget with a nested budget for a cache
+    struct memory_budget process, cache_budget;
+    memory_budget_init(&process, "process", NULL, MEMORY_BUDGET_UNLIMITED, 1024 * 1024);
+    memory_budget_init(&cache_budget, "cache", &process, 16 * 1024, 64 * 1024);
+
+    // Drop the cache if it grows too large
+    struct budget_cache cache = {.size = 0};
+    memory_budget_on_pressure(&cache_budget, drop_cache, &cache);
+
+    // Fill the cache, the soft limit is crossed on the way
+    for (size_t i = 0; i < 8; ++i) {
+        void *entry = budget_malloc(&cache_budget, 4 * 1024);
+        if (entry != NULL) {
+            cache.entries[cache.size++] = entry;
+        }
+    }
+
+    // Allocate and grow an array
+    int *a = budget_realloc(&process, NULL, sizeof(int));
+    printf("  a: %p\n", (void *) a);
+
+    // Growing beyond the hard limit fails without touching a, so we keep our
+    // reference and can free it.
+    int *b = budget_realloc(&process, a, sizeof(int) * MAX_INT_ARRAY_SIZE);
+    printf("  b: %p\n", (void *) b);
+    if (b != NULL) {
+        a = b;
+    }
+
+    memory_budget_report(stdout, &process);
+
+    // Free everything
+    budget_free(a);
+    while (cache.size != 0) {
+        budget_free(cache.entries[--cache.size]);
+    }
+}
+
 // Main function
 int main()
 {
@@ -260,6 +261,7 @@ int main()
     showcase_own_source_drain_function();
     showcase_global_lifecycle();
     showcase_realloc_pitfall();
+    showcase_budgeted_realloc();
 
     return 0;
 }
\ No newline at end of file
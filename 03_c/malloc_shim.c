@@ -0,0 +1,521 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+// A shared library tracking the heap of unmodified programs (Linux only). Load
+// it using LD_PRELOAD, e.g.
+//   LD_PRELOAD=./lib03_c_malloc_shim.so ./03_c
+// It interposes malloc, calloc, realloc, free, posix_memalign, aligned_alloc,
+// memalign, valloc and pvalloc, forwards them to the next implementation
+// (found using dlsym(RTLD_NEXT)) and records every live block in a lock-free
+// hash table. When the program exits, leaked blocks (grouped by the calling
+// code) and invalid frees are written to stderr.
+//
+// Invalid frees (double frees or pointers never allocated) are not forwarded,
+// so the program keeps running and the report can be written. This relies on
+// every allocation going through one of the functions above. Memory obtained
+// from the real allocator in any other way (e.g. a function added to a later
+// glibc) is reported as invalid free and leaked instead of freed.
+//
+// Freed blocks leave a tombstone in the table, which is only reused by later
+// insertions and never cleared (this would race with concurrent insertions).
+// Programs churning through many distinct addresses therefore make lookups
+// slower over time, in the worst case a free of an untracked pointer probes
+// the whole table.
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// The number of slots of the table (a power of two). Blocks beyond that are
+// not tracked.
+#define SHIM_TABLE_BITS 22
+#define SHIM_TABLE_SIZE ((size_t) 1 << SHIM_TABLE_BITS)
+
+// Keys of slots that are not used by a block.
+#define SHIM_EMPTY     ((uintptr_t) 0)
+#define SHIM_TOMBSTONE ((uintptr_t) 1)
+
+// Memory handed out while the real functions are resolved (dlsym allocates).
+#define SHIM_BOOTSTRAP_SIZE (64 * 1024)
+
+// The number of invalid frees and calling sites listed in the report.
+#define SHIM_MAX_INVALID_FREES 16
+#define SHIM_MAX_SITES         64
+#define SHIM_REPORTED_SITES    16
+
+// A slot of the table. The key is the address of the block, the other fields
+// are only read when the report is written.
+struct slot {
+    _Atomic uintptr_t key;
+    size_t            size;
+    void             *caller;
+};
+
+// Leaked blocks allocated by the same code.
+struct site {
+    void  *caller;
+    size_t count;
+    size_t bytes;
+};
+
+// A free of a block that is not tracked.
+struct invalid_free {
+    void *ptr;
+    void *caller;
+};
+
+// The functions that are interposed.
+static struct {
+    void *(*malloc)(size_t);
+    void *(*calloc)(size_t, size_t);
+    void *(*realloc)(void *, size_t);
+    void (*free)(void *);
+    int (*posix_memalign)(void **, size_t, size_t);
+    void *(*aligned_alloc)(size_t, size_t);
+    void *(*memalign)(size_t, size_t);
+    void *(*valloc)(size_t);
+    void *(*pvalloc)(size_t);
+} s_real;
+
+// The initialization state: 0 not started, 1 in progress, 2 done.
+static atomic_int s_state;
+
+// The tracked blocks (mapped when initialized).
+static struct slot *s_table;
+
+// The number of blocks that could not be tracked because the table was full.
+static atomic_size_t s_untracked;
+
+// Set while the report is written, allocations are not tracked anymore.
+static atomic_int s_reporting;
+
+// Invalid frees, only the first SHIM_MAX_INVALID_FREES are kept.
+static atomic_size_t       s_invalid_frees_size;
+static struct invalid_free s_invalid_frees[SHIM_MAX_INVALID_FREES];
+
+// Memory used before the real functions are known. Never freed.
+static _Alignas(max_align_t) unsigned char s_bootstrap[SHIM_BOOTSTRAP_SIZE];
+static atomic_size_t s_bootstrap_used;
+
+// Looks up the next definition of a function.
+static void resolve_symbol(void *_function, const char *_name)
+{
+    // Copy the object pointer, ISO C does not allow converting it directly
+    void *symbol = dlsym(RTLD_NEXT, _name);
+    memcpy(_function, &symbol, sizeof(symbol));
+}
+
+// Resolves the real functions and maps the table once. Returns 0 while this is
+// in progress (the caller has to use the bootstrap memory), non-zero after.
+static int initialize(void)
+{
+    if (atomic_load_explicit(&s_state, memory_order_acquire) == 2) {
+        return 1;
+    }
+
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&s_state, &expected, 1)) {
+        return atomic_load_explicit(&s_state, memory_order_acquire) == 2;
+    }
+
+    resolve_symbol(&s_real.malloc, "malloc");
+    resolve_symbol(&s_real.calloc, "calloc");
+    resolve_symbol(&s_real.realloc, "realloc");
+    resolve_symbol(&s_real.free, "free");
+    resolve_symbol(&s_real.posix_memalign, "posix_memalign");
+    resolve_symbol(&s_real.aligned_alloc, "aligned_alloc");
+    resolve_symbol(&s_real.memalign, "memalign");
+    resolve_symbol(&s_real.valloc, "valloc");
+    resolve_symbol(&s_real.pvalloc, "pvalloc");
+
+    // Pages are only backed by memory once they are touched
+    void *table = mmap(NULL, sizeof(struct slot) * SHIM_TABLE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    s_table     = table == MAP_FAILED ? NULL : table;
+
+    atomic_store_explicit(&s_state, 2, memory_order_release);
+    return 1;
+}
+
+// Allocates memory from the bootstrap buffer.
+static void *bootstrap_alloc(size_t _size, size_t _alignment)
+{
+    // The size is stored in front of the block (for realloc)
+    const size_t header = _alignment > sizeof(max_align_t) ? _alignment : sizeof(max_align_t);
+
+    size_t used = atomic_load(&s_bootstrap_used);
+    size_t begin;
+    do {
+        begin = (used + _alignment - 1) & ~(_alignment - 1);
+        if (_size > SHIM_BOOTSTRAP_SIZE || begin + header + _size > SHIM_BOOTSTRAP_SIZE) {
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak(&s_bootstrap_used, &used, begin + header + _size));
+
+    memcpy(s_bootstrap + begin + header - sizeof(size_t), &_size, sizeof(size_t));
+    return s_bootstrap + begin + header;
+}
+
+// Returns non-zero if a pointer belongs to the bootstrap buffer.
+static int is_bootstrap(const void *_ptr)
+{
+    return (const unsigned char *) _ptr >= s_bootstrap && (const unsigned char *) _ptr < s_bootstrap + SHIM_BOOTSTRAP_SIZE;
+}
+
+// Returns the first slot to probe for a block.
+static size_t hash(uintptr_t _key)
+{
+    return (size_t) (((uint64_t) _key * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - SHIM_TABLE_BITS));
+}
+
+// Adds a block to the table.
+static void track(void *_ptr, size_t _size, void *_caller)
+{
+    if (_ptr == NULL || atomic_load_explicit(&s_reporting, memory_order_relaxed)) {
+        return;
+    }
+
+    if (s_table != NULL) {
+        const uintptr_t key   = (uintptr_t) _ptr;
+        const size_t    start = hash(key);
+
+        // Claim the first empty or deleted slot
+        for (size_t i = 0; i < SHIM_TABLE_SIZE; ++i) {
+            struct slot *slot    = &s_table[(start + i) & (SHIM_TABLE_SIZE - 1)];
+            uintptr_t    current = atomic_load_explicit(&slot->key, memory_order_relaxed);
+
+            if ((current == SHIM_EMPTY || current == SHIM_TOMBSTONE) && atomic_compare_exchange_strong_explicit(&slot->key, &current, key, memory_order_acq_rel, memory_order_relaxed)) {
+                slot->size   = _size;
+                slot->caller = _caller;
+                return;
+            }
+        }
+    }
+
+    atomic_fetch_add_explicit(&s_untracked, 1, memory_order_relaxed);
+}
+
+// Removes a block from the table and copies its size and caller to _entry.
+// Returns 0 if it was not tracked.
+static int untrack(void *_ptr, struct slot *_entry)
+{
+    if (s_table == NULL) {
+        return 0;
+    }
+
+    const uintptr_t key   = (uintptr_t) _ptr;
+    const size_t    start = hash(key);
+
+    for (size_t i = 0; i < SHIM_TABLE_SIZE; ++i) {
+        struct slot *slot    = &s_table[(start + i) & (SHIM_TABLE_SIZE - 1)];
+        uintptr_t    current = atomic_load_explicit(&slot->key, memory_order_acquire);
+
+        if (current == SHIM_EMPTY) {
+            return 0;
+        }
+
+        // Only the thread freeing the block can remove it
+        if (current == key) {
+            _entry->size   = slot->size;
+            _entry->caller = slot->caller;
+            atomic_store_explicit(&slot->key, SHIM_TOMBSTONE, memory_order_release);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Checks a pointer passed to free or realloc and removes it from the table.
+// Returns non-zero if it may be forwarded to the real function.
+static int release(void *_ptr, void *_caller, struct slot *_entry)
+{
+    if (untrack(_ptr, _entry)) {
+        return 1;
+    }
+
+    // Blocks may be missing if the table overflowed or they were allocated
+    // while the report was written
+    if (atomic_load_explicit(&s_untracked, memory_order_relaxed) != 0 || atomic_load_explicit(&s_reporting, memory_order_relaxed)) {
+        return 1;
+    }
+
+    const size_t index = atomic_fetch_add_explicit(&s_invalid_frees_size, 1, memory_order_relaxed);
+    if (index < SHIM_MAX_INVALID_FREES) {
+        s_invalid_frees[index] = (struct invalid_free) {_ptr, _caller};
+    }
+
+    return 0;
+}
+
+void *malloc(size_t _size)
+{
+    if (!initialize()) {
+        return bootstrap_alloc(_size, sizeof(max_align_t));
+    }
+
+    void *ret = s_real.malloc(_size);
+    track(ret, _size, __builtin_return_address(0));
+    return ret;
+}
+
+void *calloc(size_t _count, size_t _size)
+{
+    if (!initialize()) {
+        // The bootstrap buffer is zero and never reused
+        return _size != 0 && _count > SIZE_MAX / _size ? NULL : bootstrap_alloc(_count * _size, sizeof(max_align_t));
+    }
+
+    void *ret = s_real.calloc(_count, _size);
+    track(ret, _count * _size, __builtin_return_address(0));
+    return ret;
+}
+
+void *realloc(void *_ptr, size_t _size)
+{
+    void *caller = __builtin_return_address(0);
+
+    if (!initialize()) {
+        // Bootstrap blocks are never reused, so a new one can be handed out
+        void *ret = bootstrap_alloc(_size, sizeof(max_align_t));
+        if (ret != NULL && _ptr != NULL) {
+            size_t size;
+            memcpy(&size, (unsigned char *) _ptr - sizeof(size_t), sizeof(size_t));
+            memcpy(ret, _ptr, size < _size ? size : _size);
+        }
+        return ret;
+    }
+
+    if (_ptr == NULL) {
+        void *ret = s_real.malloc(_size);
+        track(ret, _size, caller);
+        return ret;
+    }
+
+    // Move bootstrap blocks to the real heap
+    if (is_bootstrap(_ptr)) {
+        size_t size;
+        memcpy(&size, (unsigned char *) _ptr - sizeof(size_t), sizeof(size_t));
+
+        void *ret = s_real.malloc(_size);
+        if (ret != NULL) {
+            memcpy(ret, _ptr, size < _size ? size : _size);
+            track(ret, _size, caller);
+        }
+        return ret;
+    }
+
+    // Remember the entry of the old block, it stays valid if realloc fails
+    struct slot entry = {SHIM_EMPTY, 0, caller};
+    if (!release(_ptr, caller, &entry)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    void *ret = s_real.realloc(_ptr, _size);
+    if (ret == NULL && _size != 0) {
+        track(_ptr, entry.size, entry.caller);
+    } else {
+        track(ret, _size, caller);
+    }
+
+    return ret;
+}
+
+void free(void *_ptr)
+{
+    // Bootstrap blocks are never freed
+    if (_ptr == NULL || is_bootstrap(_ptr)) {
+        return;
+    }
+
+    struct slot entry;
+    if (release(_ptr, __builtin_return_address(0), &entry)) {
+        s_real.free(_ptr);
+    }
+}
+
+int posix_memalign(void **_ptr, size_t _alignment, size_t _size)
+{
+    if (!initialize()) {
+        *_ptr = bootstrap_alloc(_size, _alignment);
+        return *_ptr == NULL ? ENOMEM : 0;
+    }
+
+    const int ret = s_real.posix_memalign(_ptr, _alignment, _size);
+    if (ret == 0) {
+        track(*_ptr, _size, __builtin_return_address(0));
+    }
+
+    return ret;
+}
+
+void *aligned_alloc(size_t _alignment, size_t _size)
+{
+    if (!initialize()) {
+        return bootstrap_alloc(_size, _alignment);
+    }
+
+    void *ret = s_real.aligned_alloc(_alignment, _size);
+    track(ret, _size, __builtin_return_address(0));
+    return ret;
+}
+
+void *memalign(size_t _alignment, size_t _size)
+{
+    if (!initialize()) {
+        return bootstrap_alloc(_size, _alignment);
+    }
+
+    void *ret = s_real.memalign(_alignment, _size);
+    track(ret, _size, __builtin_return_address(0));
+    return ret;
+}
+
+void *valloc(size_t _size)
+{
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+
+    if (!initialize()) {
+        return bootstrap_alloc(_size, page);
+    }
+
+    void *ret = s_real.valloc(_size);
+    track(ret, _size, __builtin_return_address(0));
+    return ret;
+}
+
+void *pvalloc(size_t _size)
+{
+    // The size is rounded up to whole pages
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t size = _size == 0 ? page : (_size + page - 1) & ~(page - 1);
+
+    if (!initialize()) {
+        return size < _size ? NULL : bootstrap_alloc(size, page);
+    }
+
+    void *ret = s_real.pvalloc(_size);
+    track(ret, size, __builtin_return_address(0));
+    return ret;
+}
+
+// Writes a formatted line to stderr without using stdio streams.
+__attribute__((format(printf, 1, 2))) static void print(const char *_format, ...)
+{
+    char    line[512];
+    va_list args;
+
+    va_start(args, _format);
+    const int size = vsnprintf(line, sizeof(line), _format, args);
+    va_end(args);
+
+    if (size > 0) {
+        const ssize_t written = write(STDERR_FILENO, line, (size_t) size < sizeof(line) ? (size_t) size : sizeof(line) - 1);
+        (void) written;
+    }
+}
+
+// Writes the calling code as module+offset (usable with addr2line -e).
+static void print_site(const char *_prefix, void *_caller)
+{
+    Dl_info info;
+    if (dladdr(_caller, &info) != 0 && info.dli_fname != NULL) {
+        const char *name = strrchr(info.dli_fname, '/');
+        print("%s%s+%#zx\n", _prefix, name != NULL ? name + 1 : info.dli_fname, (size_t) ((uintptr_t) _caller - (uintptr_t) info.dli_fbase));
+    } else {
+        print("%s%p\n", _prefix, _caller);
+    }
+}
+
+// Reports leaks and invalid frees when the program exits.
+__attribute__((destructor)) static void report(void)
+{
+    if (atomic_load(&s_state) != 2) {
+        return;
+    }
+
+    atomic_store(&s_reporting, 1);
+
+    // Group the leaked blocks by calling code
+    struct site sites[SHIM_MAX_SITES];
+    size_t      sites_size = 0;
+    struct site other      = {NULL, 0, 0};
+    size_t      count      = 0;
+    size_t      bytes      = 0;
+
+    for (size_t i = 0; s_table != NULL && i < SHIM_TABLE_SIZE; ++i) {
+        const uintptr_t key = atomic_load(&s_table[i].key);
+        if (key == SHIM_EMPTY || key == SHIM_TOMBSTONE) {
+            continue;
+        }
+
+        ++count;
+        bytes += s_table[i].size;
+
+        size_t index = 0;
+        while (index < sites_size && sites[index].caller != s_table[i].caller) {
+            ++index;
+        }
+
+        struct site *site = &other;
+        if (index < sites_size) {
+            site = &sites[index];
+        } else if (sites_size < SHIM_MAX_SITES) {
+            site  = &sites[sites_size++];
+            *site = (struct site) {s_table[i].caller, 0, 0};
+        }
+
+        ++site->count;
+        site->bytes += s_table[i].size;
+    }
+
+    // Sort by bytes (insertion sort, there are only few sites)
+    for (size_t i = 1; i < sites_size; ++i) {
+        const struct site current = sites[i];
+        size_t            j       = i;
+        while (j > 0 && sites[j - 1].bytes < current.bytes) {
+            sites[j] = sites[j - 1];
+            --j;
+        }
+        sites[j] = current;
+    }
+
+    print("malloc_shim: %zu leaked block(s), %zu bytes.\n", count, bytes);
+    for (size_t i = 0; i < sites_size && i < SHIM_REPORTED_SITES; ++i) {
+        char prefix[96];
+        snprintf(prefix, sizeof(prefix), "  %zu bytes in %zu block(s) allocated at ", sites[i].bytes, sites[i].count);
+        print_site(prefix, sites[i].caller);
+    }
+
+    for (size_t i = SHIM_REPORTED_SITES; i < sites_size; ++i) {
+        other.count += sites[i].count;
+        other.bytes += sites[i].bytes;
+    }
+
+    if (other.count != 0) {
+        print("  %zu bytes in %zu block(s) allocated elsewhere\n", other.bytes, other.count);
+    }
+
+    // Show invalid frees
+    const size_t invalid_frees = atomic_load(&s_invalid_frees_size);
+    print("malloc_shim: %zu invalid free(s).\n", invalid_frees);
+    for (size_t i = 0; i < invalid_frees && i < SHIM_MAX_INVALID_FREES; ++i) {
+        char prefix[96];
+        snprintf(prefix, sizeof(prefix), "  free(%p) at ", s_invalid_frees[i].ptr);
+        print_site(prefix, s_invalid_frees[i].caller);
+    }
+
+    const size_t untracked = atomic_load(&s_untracked);
+    if (untracked != 0) {
+        print("malloc_shim: %zu block(s) not tracked (table full), invalid frees are not detected.\n", untracked);
+    }
+}
@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "memory_budget.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Stored in front of every allocation. The union keeps the memory returned to
+// the caller suitably aligned.
+union budget_header {
+    struct {
+        struct memory_budget *budget;
+        size_t                size;
+    } info;
+    max_align_t alignment;
+};
+
+void memory_budget_init(struct memory_budget *_budget, const char *_name, struct memory_budget *_parent, size_t _soft_limit, size_t _hard_limit)
+{
+    _budget->name           = _name;
+    _budget->parent         = _parent;
+    _budget->first_child    = NULL;
+    _budget->next_sibling   = NULL;
+    _budget->soft_limit     = _soft_limit;
+    _budget->hard_limit     = _hard_limit;
+    _budget->callbacks_size = 0;
+
+    atomic_init(&_budget->used, 0);
+    atomic_init(&_budget->peak, 0);
+    atomic_init(&_budget->failures, 0);
+
+    // Add to the children of the parent
+    if (_parent != NULL) {
+        _budget->next_sibling = _parent->first_child;
+        _parent->first_child  = _budget;
+    }
+}
+
+int memory_budget_on_pressure(struct memory_budget *_budget, memory_budget_callback _callback, void *_user_data)
+{
+    if (_budget->callbacks_size == MEMORY_BUDGET_MAX_CALLBACKS) {
+        return 0;
+    }
+
+    _budget->callbacks[_budget->callbacks_size] = _callback;
+    _budget->user_data[_budget->callbacks_size] = _user_data;
+    ++_budget->callbacks_size;
+
+    return 1;
+}
+
+int memory_budget_charge(struct memory_budget *_budget, size_t _bytes)
+{
+    // Charge every level, stop at the first hard limit that is exceeded
+    struct memory_budget *iter;
+    for (iter = _budget; iter != NULL; iter = iter->parent) {
+        const size_t previous = atomic_fetch_add_explicit(&iter->used, _bytes, memory_order_relaxed);
+
+        if (previous + _bytes < previous || previous + _bytes > iter->hard_limit) {
+            break;
+        }
+    }
+
+    // Roll back all levels charged so far (including the failing one)
+    if (iter != NULL) {
+        atomic_fetch_add_explicit(&iter->failures, 1, memory_order_relaxed);
+
+        for (struct memory_budget *undo = _budget; undo != iter->parent; undo = undo->parent) {
+            atomic_fetch_sub_explicit(&undo->used, _bytes, memory_order_relaxed);
+        }
+
+        return 0;
+    }
+
+    // Update peaks and notify budgets that crossed their soft limit
+    for (iter = _budget; iter != NULL; iter = iter->parent) {
+        const size_t used = atomic_load_explicit(&iter->used, memory_order_relaxed);
+        size_t       peak = atomic_load_explicit(&iter->peak, memory_order_relaxed);
+
+        while (used > peak && !atomic_compare_exchange_weak_explicit(&iter->peak, &peak, used, memory_order_relaxed, memory_order_relaxed)) {
+        }
+
+        if (used > iter->soft_limit && used - _bytes <= iter->soft_limit) {
+            for (size_t i = 0; i < iter->callbacks_size; ++i) {
+                iter->callbacks[i](iter, iter->user_data[i]);
+            }
+        }
+    }
+
+    return 1;
+}
+
+void memory_budget_uncharge(struct memory_budget *_budget, size_t _bytes)
+{
+    for (struct memory_budget *iter = _budget; iter != NULL; iter = iter->parent) {
+        atomic_fetch_sub_explicit(&iter->used, _bytes, memory_order_relaxed);
+    }
+}
+
+// Writes a budget and its descendants with a given indentation.
+static void report(FILE *_out, const struct memory_budget *_budget, int _depth)
+{
+    fprintf(_out, "%*s%s: %zu bytes used, %zu bytes peak", 2 * _depth, "", _budget->name, atomic_load(&_budget->used), atomic_load(&_budget->peak));
+
+    if (_budget->soft_limit != MEMORY_BUDGET_UNLIMITED) {
+        fprintf(_out, ", soft limit %zu", _budget->soft_limit);
+    }
+
+    if (_budget->hard_limit != MEMORY_BUDGET_UNLIMITED) {
+        fprintf(_out, ", hard limit %zu", _budget->hard_limit);
+    }
+
+    fprintf(_out, ", %zu failed charges\n", atomic_load(&_budget->failures));
+
+    for (const struct memory_budget *child = _budget->first_child; child != NULL; child = child->next_sibling) {
+        report(_out, child, _depth + 1);
+    }
+}
+
+void memory_budget_report(FILE *_out, const struct memory_budget *_budget)
+{
+    report(_out, _budget, 0);
+}
+
+void *budget_malloc(struct memory_budget *_budget, size_t _size)
+{
+    // Charge first, so no memory is touched if the budget is exhausted
+    if (!memory_budget_charge(_budget, _size)) {
+        return NULL;
+    }
+
+    // Check for overflow
+    if (_size > SIZE_MAX - sizeof(union budget_header)) {
+        memory_budget_uncharge(_budget, _size);
+        return NULL;
+    }
+
+    union budget_header *header = malloc(sizeof(union budget_header) + _size);
+    if (header == NULL) {
+        memory_budget_uncharge(_budget, _size);
+        return NULL;
+    }
+
+    header->info.budget = _budget;
+    header->info.size   = _size;
+
+    return header + 1;
+}
+
+void *budget_calloc(struct memory_budget *_budget, size_t _count, size_t _size)
+{
+    // Check for overflow
+    if (_size != 0 && _count > SIZE_MAX / _size) {
+        return NULL;
+    }
+
+    void *ret = budget_malloc(_budget, _count * _size);
+    if (ret != NULL) {
+        memset(ret, 0, _count * _size);
+    }
+
+    return ret;
+}
+
+void *budget_realloc(struct memory_budget *_budget, void *_ptr, size_t _size)
+{
+    if (_ptr == NULL) {
+        return budget_malloc(_budget, _size);
+    }
+
+    union budget_header  *header = (union budget_header *) _ptr - 1;
+    struct memory_budget *budget = header->info.budget;
+    const size_t          size   = header->info.size;
+
+    // Charge growth up front; on failure the old block stays valid
+    if (_size > size && !memory_budget_charge(budget, _size - size)) {
+        return NULL;
+    }
+
+    // Check for overflow
+    if (_size > SIZE_MAX - sizeof(union budget_header)) {
+        memory_budget_uncharge(budget, _size - size);
+        return NULL;
+    }
+
+    union budget_header *resized = realloc(header, sizeof(union budget_header) + _size);
+    if (resized == NULL) {
+        // The old block is still owned by the caller, undo the charge
+        if (_size > size) {
+            memory_budget_uncharge(budget, _size - size);
+        }
+        return NULL;
+    }
+
+    // Return shrunk bytes
+    if (_size < size) {
+        memory_budget_uncharge(budget, size - _size);
+    }
+
+    resized->info.size = _size;
+    return resized + 1;
+}
+
+void budget_free(void *_ptr)
+{
+    if (_ptr == NULL) {
+        return;
+    }
+
+    union budget_header *header = (union budget_header *) _ptr - 1;
+    memory_budget_uncharge(header->info.budget, header->info.size);
+    free(header);
+}
@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// The maximum number of pressure callbacks per budget.
+#define MEMORY_BUDGET_MAX_CALLBACKS 4
+
+// Use as limit to disable it.
+#define MEMORY_BUDGET_UNLIMITED SIZE_MAX
+
+struct memory_budget;
+
+// Called when a budget exceeds its soft limit. Typically releases caches.
+typedef void (*memory_budget_callback)(struct memory_budget *_budget, void *_user_data);
+
+/**
+ * A named memory budget. Budgets form a tree: charging a budget charges all its
+ * ancestors as well. Every charge is an atomic addition per level. A charge
+ * fails if it would exceed the hard limit of any level, in which case nothing
+ * is charged. Exceeding a soft limit succeeds but calls the registered
+ * pressure callbacks of that budget.
+ *
+ * Budgets are owned by the caller. Initialize them (and register callbacks)
+ * before they are used concurrently.
+ */
+struct memory_budget {
+    const char           *name;
+    struct memory_budget *parent;
+    struct memory_budget *first_child;
+    struct memory_budget *next_sibling;
+    size_t                soft_limit;
+    size_t                hard_limit;
+
+    atomic_size_t used;
+    atomic_size_t peak;
+    atomic_size_t failures;
+
+    size_t                 callbacks_size;
+    memory_budget_callback callbacks[MEMORY_BUDGET_MAX_CALLBACKS];
+    void                  *user_data[MEMORY_BUDGET_MAX_CALLBACKS];
+};
+
+/**
+ * Initializes a budget and adds it to the children of its parent.
+ *
+ * @param _budget The budget that is initialized.
+ * @param _name The name used in reports. Has to outlive the budget.
+ * @param _parent The parent budget or NULL.
+ * @param _soft_limit The number of bytes above which the pressure callbacks are
+ * called, or MEMORY_BUDGET_UNLIMITED.
+ * @param _hard_limit The number of bytes that cannot be exceeded, or
+ * MEMORY_BUDGET_UNLIMITED.
+ */
+void memory_budget_init(struct memory_budget *_budget, const char *_name, struct memory_budget *_parent, size_t _soft_limit, size_t _hard_limit);
+
+/**
+ * Registers a function that is called whenever a charge makes the budget
+ * exceed its soft limit. It is called from memory_budget_charge() by the
+ * charging thread without any locks held, i.e. before budget_malloc() or
+ * budget_realloc() allocate. The allocation may still fail afterwards, in which
+ * case the charge is returned again.
+ *
+ * @param _budget The budget.
+ * @param _callback The function.
+ * @param _user_data Passed to the function.
+ * @return 0 if MEMORY_BUDGET_MAX_CALLBACKS callbacks are already registered,
+ * non-zero otherwise.
+ */
+int memory_budget_on_pressure(struct memory_budget *_budget, memory_budget_callback _callback, void *_user_data);
+
+/**
+ * Charges a number of bytes to a budget and its ancestors.
+ *
+ * @param _budget The budget.
+ * @param _bytes The number of bytes.
+ * @return 0 if a hard limit would be exceeded (nothing is charged), non-zero
+ * otherwise.
+ */
+int memory_budget_charge(struct memory_budget *_budget, size_t _bytes);
+
+/**
+ * Returns bytes previously charged to a budget and its ancestors.
+ *
+ * @param _budget The budget.
+ * @param _bytes The number of bytes.
+ */
+void memory_budget_uncharge(struct memory_budget *_budget, size_t _bytes);
+
+/**
+ * Writes the usage of a budget and all its descendants.
+ *
+ * @param _out The output stream.
+ * @param _budget The budget.
+ */
+void memory_budget_report(FILE *_out, const struct memory_budget *_budget);
+
+/**
+ * Allocates memory charged to a budget. Free it using budget_free().
+ *
+ * @param _budget The budget.
+ * @param _size The number of bytes.
+ * @return NULL if the budget or the system is exhausted.
+ */
+void *budget_malloc(struct memory_budget *_budget, size_t _size);
+
+/**
+ * Allocates zeroed memory for an array charged to a budget. Free it using
+ * budget_free().
+ *
+ * @param _budget The budget.
+ * @param _count The number of elements.
+ * @param _size The size of an element.
+ * @return NULL if the budget or the system is exhausted or the size overflows.
+ */
+void *budget_calloc(struct memory_budget *_budget, size_t _count, size_t _size);
+
+/**
+ * Resizes memory obtained from a budget. Unlike the common misuse of realloc()
+ * the caller keeps ownership of _ptr on failure.
+ *
+ * @param _budget The budget charged if _ptr is NULL. Otherwise the budget _ptr
+ * was allocated from is used.
+ * @param _ptr The memory, NULL to allocate new memory.
+ * @param _size The new number of bytes.
+ * @return The resized memory or NULL if the budget or the system is exhausted.
+ * In the latter case _ptr is unchanged and still has to be freed.
+ */
+void *budget_realloc(struct memory_budget *_budget, void *_ptr, size_t _size);
+
+/**
+ * Frees memory obtained from a budget and returns its bytes.
+ *
+ * @param _ptr The memory or NULL.
+ */
+void budget_free(void *_ptr);
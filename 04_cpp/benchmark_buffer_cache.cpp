@@ -0,0 +1,109 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "buffer_cache.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// The recurring array sizes of the simulated workload.
+static const size_t s_sizes[] = {16, 100, 1000, 4096, 50000, 300000};
+
+// The number of arrays alive at the same time within one iteration.
+static const size_t s_live = 4;
+
+// Simulates the allocation pattern of dyn_array_move objects that are created
+// and destroyed in a tight loop. Allocate and Deallocate are used to obtain and
+// free the arrays.
+template <typename Allocate, typename Deallocate>
+long long churn(const size_t &_iterations, Allocate _allocate, Deallocate _deallocate)
+{
+    long long checksum = 0;
+
+    for (size_t i = 0; i < _iterations; ++i) {
+        const size_t size = s_sizes[i % (sizeof(s_sizes) / sizeof(*s_sizes))];
+
+        // Construct some arrays and touch their memory
+        int *arrays[s_live];
+        for (size_t j = 0; j < s_live; ++j) {
+            arrays[j]           = _allocate(size);
+            arrays[j][0]        = static_cast<int>(j);
+            arrays[j][size - 1] = static_cast<int>(i);
+        }
+
+        // Destruct them again
+        for (size_t j = 0; j < s_live; ++j) {
+            checksum += arrays[j][0] + arrays[j][size - 1];
+            _deallocate(arrays[j], size);
+        }
+    }
+
+    return checksum;
+}
+
+// Runs the churn on a given number of threads and returns the elapsed seconds.
+template <typename Allocate, typename Deallocate>
+double run(const size_t &_threads, const size_t &_iterations, Allocate _allocate, Deallocate _deallocate)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    std::vector<long long>   checksums(_threads, 0);
+    for (size_t t = 0; t < _threads; ++t) {
+        threads.emplace_back([&, t]() { checksums[t] = churn(_iterations, _allocate, _deallocate); });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    // Prevent the work from being optimized away
+    long long checksum = 0;
+    for (const long long &val : checksums) {
+        checksum += val;
+    }
+    std::cout << "    (checksum " << checksum << ")\n";
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Compares plain new[]/delete[] with buffer_cache.
+int main()
+{
+    const size_t iterations = 200000;
+
+    for (const size_t threads : {1, 4}) {
+        std::cout << "threads: " << threads << ", iterations per thread: " << iterations << "\n";
+
+        const double plain = run(
+            threads, iterations,
+            [](const size_t &_size) { return new int[_size]; },
+            [](int *_data, const size_t &) { delete[] _data; });
+        std::cout << "  new[]/delete[]: " << plain << " s\n";
+
+        const double cached = run(
+            threads, iterations,
+            [](const size_t &_size) { return buffer_cache<int>::acquire(_size); },
+            [](int *_data, const size_t &_size) { buffer_cache<int>::release(_data, _size); });
+        std::cout << "  buffer_cache:   " << cached << " s (speedup " << plain / cached << "x)\n";
+    }
+
+    // Show the cache statistics
+    const auto stats = buffer_cache<int>::stats();
+    std::cout << "hit rate: " << stats.hit_rate() * 100. << " %\n"
+              << "hits: " << stats.hits << ", misses: " << stats.misses << ", bypasses: " << stats.bypasses << "\n"
+              << "releases: " << stats.releases << ", drops: " << stats.drops << "\n"
+              << "bytes retained: " << stats.bytes_retained << "\n";
+
+    // Release retained memory
+    buffer_cache<int>::flush_thread();
+    buffer_cache<int>::trim(0);
+    std::cout << "bytes retained after trim: " << buffer_cache<int>::stats().bytes_retained << "\n";
+
+    return 0;
+}
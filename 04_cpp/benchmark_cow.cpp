@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "dyn_array_cow.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// The number of elements of every array.
+static const size_t s_size = 4096;
+
+// The number of copies kept alive at the same time.
+static const size_t s_kept = 16;
+
+// Element access of a deep copying array (like dyn_array).
+int read(const std::vector<int> &_array, const size_t &_index)
+{
+    return _array[_index];
+}
+
+void write(std::vector<int> &_array, const size_t &_index, const int &_value)
+{
+    _array[_index] = _value;
+}
+
+// Element access of a copy-on-write array.
+template <typename Refcount>
+int read(const dyn_array_cow<Refcount> &_array, const size_t &_index)
+{
+    return _array[_index];
+}
+
+template <typename Refcount>
+void write(dyn_array_cow<Refcount> &_array, const size_t &_index, const int &_value)
+{
+    _array.mutable_data()[_index] = _value;
+}
+
+// Simulates code that copies an array often (e.g. by value parameters and
+// cached versions) but rarely modifies a copy. Every _write_every-th copy is
+// modified. Returns the elapsed seconds.
+template <typename Array>
+double copy_heavy(const size_t &_iterations, const size_t &_write_every)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // Parentheses, braces would create a std::vector with one element
+    Array source(s_size);
+    for (size_t i = 0; i < s_size; ++i) {
+        write(source, i, static_cast<int>(i));
+    }
+
+    std::vector<Array> kept(s_kept, source);
+    long long          checksum = 0;
+
+    for (size_t i = 0; i < _iterations; ++i) {
+        // Copy and read a few elements
+        Array copy{source};
+        checksum += read(copy, i % s_size) + read(copy, (i * 7) % s_size);
+
+        // Rarely modify the copy
+        if (i % _write_every == 0) {
+            write(copy, i % s_size, -1);
+        }
+
+        // Keep it around for a while
+        kept[i % s_kept] = copy;
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    // Prevent the work from being optimized away
+    for (const Array &val : kept) {
+        checksum += read(val, 0);
+    }
+    std::cout << "    (checksum " << checksum << ")\n";
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Compares deep copies with the copy-on-write array and its reference counting
+// policies.
+int main()
+{
+    const size_t iterations = 200000;
+
+    for (const size_t write_every : {1000, 100, 10, 1}) {
+        std::cout << "arrays of " << s_size << " ints, " << iterations << " copies, every " << write_every << ". copy is modified\n";
+
+        const double deep = copy_heavy<std::vector<int>>(iterations, write_every);
+        std::cout << "  deep copy:                     " << deep << " s\n";
+
+        const double atomic = copy_heavy<dyn_array_cow<refcount::atomic>>(iterations, write_every);
+        std::cout << "  copy-on-write (atomic):        " << atomic << " s (speedup " << deep / atomic << "x)\n";
+
+        const double single = copy_heavy<dyn_array_cow<refcount::single_thread>>(iterations, write_every);
+        std::cout << "  copy-on-write (single thread): " << single << " s (speedup " << deep / single << "x)\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "handle_heap.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+// The number of live bytes after the allocation phase of a round.
+static const size_t s_peak_bytes = 256 << 20;
+
+// The number of live bytes after the free phase of a round.
+static const size_t s_retained_bytes = 32 << 20;
+
+// The number of rounds.
+static const size_t s_rounds = 12;
+
+// A live buffer of the simulated workload.
+struct buffer {
+    std::uintptr_t id;
+    size_t         size;
+};
+
+// Returns the resident set size of the process in bytes.
+size_t resident_bytes()
+{
+    size_t size     = 0;
+    size_t resident = 0;
+
+    if (FILE *statm = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(statm, "%zu %zu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(statm);
+    }
+
+    return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+// Simple xorshift pseudo random numbers.
+std::uint64_t next_random(std::uint64_t &_state)
+{
+    _state ^= _state << 13;
+    _state ^= _state >> 7;
+    _state ^= _state << 17;
+    return _state;
+}
+
+// Simulates a long-running process churning through buffers of varying sizes
+// (like dyn_array_move objects). Every round allocates buffers up to
+// s_peak_bytes, then frees random buffers down to s_retained_bytes. The
+// survivors are scattered over the heap, which fragments it. Allocate, Free
+// and Compact are called to manage the buffers. Prints the live bytes and the
+// RSS after every round.
+template <typename Allocate, typename Free, typename Compact>
+void churn(Allocate _allocate, Free _free, Compact _compact)
+{
+    std::vector<buffer> live;
+    size_t              live_bytes = 0;
+    std::uint64_t       state      = 42;
+
+    std::cout << "round    live MiB    RSS MiB    RSS / live\n";
+
+    for (size_t round = 0; round < s_rounds; ++round) {
+        // Sizes grow from round to round (1 KiB up to 128 KiB)
+        const size_t max_size = size_t{1024} << (round % 8);
+
+        while (live_bytes < s_peak_bytes) {
+            const size_t size = max_size / 2 + static_cast<size_t>(next_random(state) % (max_size / 2));
+            live.push_back({_allocate(size), size});
+            live_bytes += size;
+        }
+
+        while (live_bytes > s_retained_bytes) {
+            const size_t index = static_cast<size_t>(next_random(state) % live.size());
+            _free(live[index]);
+            live_bytes -= live[index].size;
+            live[index] = live.back();
+            live.pop_back();
+        }
+
+        _compact();
+
+        const double live_mib = static_cast<double>(live_bytes) / (1 << 20);
+        const double rss_mib  = static_cast<double>(resident_bytes()) / (1 << 20);
+        std::printf("%5zu %11.1f %10.1f %13.2f\n", round, live_mib, rss_mib, rss_mib / live_mib);
+    }
+
+    for (const buffer &val : live) {
+        _free(val);
+    }
+}
+
+// Compares the RSS of new[] with a compacted handle_heap for the same workload.
+// Usage: 04_cpp_benchmark_fragmentation <new|handle_heap|handle_heap_background>
+int main(int _argc, char **_argv)
+{
+    const std::string mode{_argc > 1 ? _argv[1] : ""};
+
+    if (mode == "new") {
+        std::cout << "new[]/delete[]\n";
+
+        churn(
+            [](const size_t &_size) {
+                char *data = new char[_size];
+                std::memset(data, 1, _size);
+                return reinterpret_cast<std::uintptr_t>(data);
+            },
+            [](const buffer &_buffer) { delete[] reinterpret_cast<char *>(_buffer.id); },
+            []() {});
+    } else if (mode == "handle_heap") {
+        std::cout << "handle_heap (incremental compaction, 16 MiB per step)\n";
+
+        handle_heap heap{size_t{1} << 32};
+        churn(
+            [&heap](const size_t &_size) {
+                const handle_heap::handle handle = heap.allocate(_size);
+                std::memset(heap.pinned<char>(handle).data(), 1, _size);
+                return static_cast<std::uintptr_t>(handle);
+            },
+            [&heap](const buffer &_buffer) { heap.deallocate(static_cast<handle_heap::handle>(_buffer.id)); },
+            [&heap]() {
+                size_t steps = 1;
+                while (!heap.compact_step(16 << 20)) {
+                    ++steps;
+                }
+
+                const auto stats = heap.stats();
+                std::printf("      (%zu compaction step(s), %.1f MiB moved in total)\n", steps, static_cast<double>(stats.moved_bytes) / (1 << 20));
+            });
+    } else if (mode == "handle_heap_background") {
+        std::cout << "handle_heap (background compaction above 25 % fragmentation)\n";
+
+        handle_heap heap{size_t{1} << 32};
+        heap.start_compactor(0.25, std::chrono::milliseconds{10});
+        churn(
+            [&heap](const size_t &_size) {
+                const handle_heap::handle handle = heap.allocate(_size);
+                std::memset(heap.pinned<char>(handle).data(), 1, _size);
+                return static_cast<std::uintptr_t>(handle);
+            },
+            [&heap](const buffer &_buffer) { heap.deallocate(static_cast<handle_heap::handle>(_buffer.id)); },
+            [&heap]() {
+                // Give the compactor time to catch up
+                std::this_thread::sleep_for(std::chrono::milliseconds{200});
+
+                const auto stats = heap.stats();
+                std::printf("      (%zu compaction(s), %.1f MiB moved in total)\n", stats.compactions, static_cast<double>(stats.moved_bytes) / (1 << 20));
+            });
+    } else {
+        std::cerr << "Usage: " << _argv[0] << " <new|handle_heap|handle_heap_background>\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "mapped_array.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// The number of elements requested ahead of a sequential scan (4 MiB).
+static const size_t s_window = (4 << 20) / sizeof(int);
+
+// Removes the pages of a file from the page cache, so the next scan has to
+// read from the disk. Only works for pages that were written back.
+void evict(const std::string &_path)
+{
+    const int file = ::open(_path.c_str(), O_RDONLY);
+    if (file != -1) {
+        ::posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(file);
+    }
+}
+
+// Simple xorshift pseudo random numbers.
+std::uint64_t next_random(std::uint64_t &_state)
+{
+    _state ^= _state << 13;
+    _state ^= _state >> 7;
+    _state ^= _state << 17;
+    return _state;
+}
+
+// Sums up all elements in order. Returns the elapsed seconds.
+double sequential_scan(const std::string &_path, const mapped_array<int>::access_pattern &_pattern, const bool &_read_ahead)
+{
+    evict(_path);
+    const auto start = std::chrono::steady_clock::now();
+
+    mapped_array<int> array{_path, mapped_array<int>::open_mode::read_only};
+    array.advise(_pattern);
+
+    long long checksum = 0;
+    for (size_t i = 0; i < array.size; ++i) {
+        if (_read_ahead && i % s_window == 0) {
+            array.read_ahead(i, s_window);
+        }
+        checksum += array.data[i];
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    std::cout << "    (checksum " << checksum << ")\n";
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Reads one element per page of the file at random positions. Returns the
+// elapsed seconds.
+double random_scan(const std::string &_path, const mapped_array<int>::access_pattern &_pattern)
+{
+    evict(_path);
+    const auto start = std::chrono::steady_clock::now();
+
+    mapped_array<int> array{_path, mapped_array<int>::open_mode::read_only};
+    array.advise(_pattern);
+
+    const size_t  reads    = array.size * sizeof(int) / 4096;
+    std::uint64_t state    = 42;
+    long long     checksum = 0;
+    for (size_t i = 0; i < reads; ++i) {
+        checksum += array.data[next_random(state) % array.size];
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    std::cout << "    (checksum " << checksum << ")\n";
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Compares sequential and random scans over a file-backed array with different
+// access pattern hints.
+// Usage: 04_cpp_benchmark_mapped_array [size in MiB] [file]
+int main(int _argc, char **_argv)
+{
+    const size_t      mebibytes = _argc > 1 ? std::strtoull(_argv[1], nullptr, 10) : 256;
+    const std::string path{_argc > 2 ? _argv[2] : "mapped_array.bin"};
+    const size_t      elements = (mebibytes << 20) / sizeof(int);
+
+    try {
+        // Create and fill the file through the mapping
+        {
+            const auto start = std::chrono::steady_clock::now();
+
+            mapped_array<int> array{path, mapped_array<int>::open_mode::create, elements};
+            array.advise(mapped_array<int>::access_pattern::sequential);
+            for (size_t i = 0; i < array.size; ++i) {
+                array.data[i] = static_cast<int>(i);
+            }
+            array.flush(mapped_array<int>::flush_mode::sync);
+
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "write " << mebibytes << " MiB and flush: " << mebibytes / seconds << " MiB/s\n";
+        }
+
+        const double normal = sequential_scan(path, mapped_array<int>::access_pattern::normal, false);
+        std::cout << "sequential, no hint:              " << mebibytes / normal << " MiB/s\n";
+
+        const double sequential = sequential_scan(path, mapped_array<int>::access_pattern::sequential, false);
+        std::cout << "sequential, SEQUENTIAL:           " << mebibytes / sequential << " MiB/s\n";
+
+        const double read_ahead = sequential_scan(path, mapped_array<int>::access_pattern::sequential, true);
+        std::cout << "sequential, SEQUENTIAL+WILLNEED:  " << mebibytes / read_ahead << " MiB/s\n";
+
+        const double random_normal = random_scan(path, mapped_array<int>::access_pattern::normal);
+        std::cout << "random, no hint:                  " << random_normal / static_cast<double>(elements * sizeof(int) / 4096) * 1e6 << " us/read\n";
+
+        const double random = random_scan(path, mapped_array<int>::access_pattern::random);
+        std::cout << "random, RANDOM:                   " << random / static_cast<double>(elements * sizeof(int) / 4096) * 1e6 << " us/read\n";
+    } catch (const std::system_error &_e) {
+        std::cerr << _e.what() << "\n";
+        std::remove(path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::remove(path.c_str());
+    return EXIT_SUCCESS;
+}
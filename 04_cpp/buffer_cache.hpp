@@ -0,0 +1,279 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * A bounded cache of freed arrays of type T. Arrays are grouped into buckets by
+ * their capacity, which is always a power of two. Every thread owns a small
+ * front cache per bucket that is accessed without locking. If it runs empty or
+ * full, buffers are exchanged in batches with a shared back cache guarded by a
+ * mutex. Each front cache retains at most s_front_max_bytes, larger buffers are
+ * passed on to the back cache directly. The back cache retains at most the
+ * number of bytes set by trim() (64 MiB by default). In total the cache retains
+ * at most that limit plus s_front_max_bytes per thread.
+ *
+ * @tparam T The element type of the cached arrays.
+ */
+template <typename T>
+class buffer_cache {
+  public:
+    // Arrays with more elements than 2^s_max_bucket bypass the cache.
+    static constexpr size_t s_max_bucket{22};
+
+    // The number of buffers each thread keeps per bucket.
+    static constexpr size_t s_front_capacity{8};
+
+    // The number of bytes each thread keeps in its front cache.
+    static constexpr size_t s_front_max_bytes{4 * 1024 * 1024};
+
+    // Statistics about the cache usage.
+    struct statistics {
+        size_t hits;
+        size_t misses;
+        size_t bypasses;
+        size_t releases;
+        size_t drops;
+        size_t bytes_retained;
+
+        // Returns the ratio of acquisitions served from the cache.
+        double hit_rate() const
+        {
+            return hits + misses == 0 ? 0. : static_cast<double>(hits) / static_cast<double>(hits + misses);
+        }
+    };
+
+  private:
+    // The per thread front cache. Returns its buffers to the back cache when
+    // the thread exits.
+    struct front {
+        std::array<std::array<T *, s_front_capacity>, s_max_bucket + 1> buffers{};
+        std::array<size_t, s_max_bucket + 1>                            sizes{};
+        size_t                                                          bytes{0};
+
+        ~front()
+        {
+            flush();
+        }
+
+        // Moves all buffers to the back cache.
+        void flush()
+        {
+            for (size_t bucket = 0; bucket <= s_max_bucket; ++bucket) {
+                give_back(bucket, buffers[bucket].data(), sizes[bucket]);
+                sizes[bucket] = 0;
+            }
+            bytes = 0;
+        }
+    };
+
+    // The shared back cache. Deletes all buffers on destruction.
+    struct back {
+        std::array<std::vector<T *>, s_max_bucket + 1> buffers{};
+
+        ~back()
+        {
+            for (auto &bucket : buffers) {
+                for (T *buffer : bucket) {
+                    delete[] buffer;
+                }
+            }
+        }
+    };
+
+  private:
+    // The buffers of the current thread.
+    static inline thread_local front s_front{};
+
+    // The buffers shared between all threads.
+    static inline back s_back{};
+
+    // Protects s_back and s_max_retained_bytes.
+    static inline std::mutex s_mutex{};
+
+    // The maximum number of bytes the back cache retains.
+    static inline size_t s_max_retained_bytes{64 * 1024 * 1024};
+
+    // Counters backing statistics.
+    static inline std::atomic<size_t> s_hits{0};
+    static inline std::atomic<size_t> s_misses{0};
+    static inline std::atomic<size_t> s_bypasses{0};
+    static inline std::atomic<size_t> s_releases{0};
+    static inline std::atomic<size_t> s_drops{0};
+    static inline std::atomic<size_t> s_bytes_retained{0};
+
+    // The number of bytes held by s_back, protected by s_mutex.
+    static inline size_t s_back_bytes{0};
+
+  private:
+    // Returns the smallest bucket whose capacity can hold _size elements.
+    static size_t bucket_of(const size_t &_size)
+    {
+        size_t bucket = 0;
+        while ((static_cast<size_t>(1) << bucket) < _size) {
+            ++bucket;
+        }
+
+        return bucket;
+    }
+
+    // Returns the number of bytes of a buffer in a given bucket.
+    static size_t bytes_of(const size_t &_bucket)
+    {
+        return sizeof(T) << _bucket;
+    }
+
+    // Moves _count buffers to the back cache, deleting what does not fit.
+    static void give_back(const size_t &_bucket, T *const *_buffers, const size_t &_count)
+    {
+        if (_count == 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{s_mutex};
+        for (size_t i = 0; i < _count; ++i) {
+            if (s_back_bytes + bytes_of(_bucket) <= s_max_retained_bytes) {
+                s_back.buffers[_bucket].push_back(_buffers[i]);
+                s_back_bytes += bytes_of(_bucket);
+            } else {
+                delete[] _buffers[i];
+                s_bytes_retained -= bytes_of(_bucket);
+                ++s_drops;
+            }
+        }
+    }
+
+    // Refills the front cache of a bucket with up to half its capacity. Only
+    // the first buffer may exceed s_front_max_bytes, it is handed out at once.
+    static void refill(const size_t &_bucket)
+    {
+        std::lock_guard<std::mutex> lock{s_mutex};
+
+        auto &source = s_back.buffers[_bucket];
+        while (!source.empty() && s_front.sizes[_bucket] < s_front_capacity / 2 && (s_front.sizes[_bucket] == 0 || s_front.bytes + bytes_of(_bucket) <= s_front_max_bytes)) {
+            s_front.buffers[_bucket][s_front.sizes[_bucket]++] = source.back();
+            source.pop_back();
+            s_back_bytes -= bytes_of(_bucket);
+            s_front.bytes += bytes_of(_bucket);
+        }
+    }
+
+  public:
+    /**
+     * Returns an array that can hold at least _size elements. The elements are
+     * default initialized, i.e. reused arrays contain their previous values.
+     * The array has to be released using release() with the same _size.
+     *
+     * @param _size The number of elements.
+     * @return A cached array or the result of new T[] if there is none.
+     */
+    static T *acquire(const size_t &_size)
+    {
+        const size_t bucket = bucket_of(_size);
+
+        // Large arrays are not cached
+        if (bucket > s_max_bucket) {
+            ++s_bypasses;
+            return new T[_size];
+        }
+
+        // Fetch a batch from the shared cache if this thread has none
+        if (s_front.sizes[bucket] == 0) {
+            refill(bucket);
+        }
+
+        // Serve from the front cache if possible
+        if (s_front.sizes[bucket] != 0) {
+            ++s_hits;
+            s_bytes_retained -= bytes_of(bucket);
+            s_front.bytes -= bytes_of(bucket);
+            return s_front.buffers[bucket][--s_front.sizes[bucket]];
+        }
+
+        ++s_misses;
+        return new T[static_cast<size_t>(1) << bucket];
+    }
+
+    /**
+     * Returns an array obtained by acquire() to the cache.
+     *
+     * @param _buffer The array, may be nullptr.
+     * @param _size The number of elements passed to acquire().
+     */
+    static void release(T *_buffer, const size_t &_size)
+    {
+        if (_buffer == nullptr) {
+            return;
+        }
+
+        const size_t bucket = bucket_of(_size);
+
+        // Large arrays are not cached
+        if (bucket > s_max_bucket) {
+            delete[] _buffer;
+            return;
+        }
+
+        ++s_releases;
+        s_bytes_retained += bytes_of(bucket);
+
+        // Move half of the front cache to the shared cache if it is full
+        if (s_front.sizes[bucket] == s_front_capacity) {
+            s_front.sizes[bucket] -= s_front_capacity / 2;
+            s_front.bytes -= s_front_capacity / 2 * bytes_of(bucket);
+            give_back(bucket, s_front.buffers[bucket].data() + s_front.sizes[bucket], s_front_capacity / 2);
+        }
+
+        // Pass the buffer on if it does not fit into the front cache
+        if (s_front.bytes + bytes_of(bucket) > s_front_max_bytes) {
+            give_back(bucket, &_buffer, 1);
+            return;
+        }
+
+        s_front.buffers[bucket][s_front.sizes[bucket]++] = _buffer;
+        s_front.bytes += bytes_of(bucket);
+    }
+
+    /**
+     * Limits the number of bytes retained by the shared cache and deletes
+     * buffers until the limit is met. Starts with the largest buffers. The
+     * front caches of the threads (at most s_front_max_bytes each) are not
+     * affected, call flush_thread() on a thread before to include its buffers.
+     *
+     * @param _max_bytes The new limit.
+     */
+    static void trim(const size_t &_max_bytes)
+    {
+        std::lock_guard<std::mutex> lock{s_mutex};
+
+        s_max_retained_bytes = _max_bytes;
+        for (size_t bucket = s_max_bucket + 1; bucket-- > 0 && s_back_bytes > _max_bytes;) {
+            auto &buffers = s_back.buffers[bucket];
+            while (!buffers.empty() && s_back_bytes > _max_bytes) {
+                delete[] buffers.back();
+                buffers.pop_back();
+                s_back_bytes -= bytes_of(bucket);
+                s_bytes_retained -= bytes_of(bucket);
+                ++s_drops;
+            }
+        }
+    }
+
+    // Moves the buffers of the calling thread to the shared cache.
+    static void flush_thread()
+    {
+        s_front.flush();
+    }
+
+    // Returns the current statistics.
+    static statistics stats()
+    {
+        return {s_hits, s_misses, s_bypasses, s_releases, s_drops, s_bytes_retained};
+    }
+};
@@ -0,0 +1,250 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "lifecycle_counted.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+
+// Reference counting policies for dyn_array_cow. Every policy offers the same
+// static interface:
+//   using type = ...;             the counter type
+//   void   increment(type &);     adds a reference
+//   bool   decrement(type &);     removes a reference, true if it was the last
+//   bool   unique(const type &);  true if there is exactly one reference
+namespace refcount {
+
+// Thread-safe counting. Copies sharing a buffer may be used (and destroyed)
+// by different threads, like std::shared_ptr.
+struct atomic {
+    using type = std::atomic<size_t>;
+
+    static void increment(type &_count)
+    {
+        _count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static bool decrement(type &_count)
+    {
+        // Acquire-release so the last owner sees all writes before freeing
+        return _count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    static bool unique(const type &_count)
+    {
+        return _count.load(std::memory_order_acquire) == 1;
+    }
+};
+
+// GCC 12 reports a use after free in decrement() once it is inlined into
+// dyn_array_cow::release() of several copies (Release builds). It cannot prove
+// that only the last owner sees the count drop to zero and deletes the block,
+// so it considers a decrement after the delete possible. False positive.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wuse-after-free"
+#endif
+
+// Plain counting without atomic instructions. All copies sharing a buffer have
+// to be used by the same thread.
+struct single_thread {
+    using type = size_t;
+
+    static void increment(type &_count)
+    {
+        ++_count;
+    }
+
+    static bool decrement(type &_count)
+    {
+        return --_count == 0;
+    }
+
+    static bool unique(const type &_count)
+    {
+        return _count == 1;
+    }
+};
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#    pragma GCC diagnostic pop
+#endif
+
+} // namespace refcount
+
+/**
+ * A dynamic array with copy-on-write semantics. Copies share the buffer and
+ * only increment a reference count. The first mutable access to a shared
+ * buffer (mutable_data()) copies it, so every array behaves as if it owned its
+ * contents. Read-only copies are therefore O(1).
+ *
+ * Read through the const members. Only call mutable_data() if the contents are
+ * actually modified, since it copies a shared buffer.
+ *
+ * @tparam Refcount The reference counting policy (see namespace refcount).
+ */
+template <typename Refcount = refcount::atomic>
+class dyn_array_cow : public lifecycle::counted<dyn_array_cow<Refcount>> {
+  private:
+    // The header of a buffer, followed by the elements in the same allocation.
+    struct block {
+        typename Refcount::type references;
+        size_t                  size;
+
+        // Returns the elements following the header.
+        int *data()
+        {
+            return reinterpret_cast<int *>(this + 1);
+        }
+    };
+
+    // The base counting the lifecycle events.
+    using counted = lifecycle::counted<dyn_array_cow<Refcount>>;
+
+  private:
+    // The (possibly shared) buffer. Only nullptr after being moved from (or
+    // copied from a moved-from array).
+    block *m_block;
+
+  public:
+    // Constructs an array with a given size.
+    explicit dyn_array_cow(const size_t &_size) :
+        m_block{allocate(_size)}
+    {
+    }
+
+    // Shares the buffer of another array.
+    dyn_array_cow(const dyn_array_cow &_other) :
+        counted{_other}, m_block{_other.m_block}
+    {
+        // A moved-from array has no buffer to share
+        if (m_block != nullptr) {
+            Refcount::increment(m_block->references);
+        }
+    }
+
+    // Takes over the buffer of another array, leaving it empty.
+    dyn_array_cow(dyn_array_cow &&_other) noexcept :
+        counted{std::move(_other)}, m_block{_other.m_block}
+    {
+        _other.m_block = nullptr;
+    }
+
+    // Releases the reference to the buffer.
+    ~dyn_array_cow()
+    {
+        release(m_block);
+    }
+
+  public:
+    // Shares the buffer of another array.
+    dyn_array_cow &operator=(const dyn_array_cow &_other)
+    {
+        // Count the assignment
+        counted::operator=(_other);
+
+        // Take the new reference first, this may be a self-assignment
+        if (_other.m_block != nullptr) {
+            Refcount::increment(_other.m_block->references);
+        }
+        release(m_block);
+        m_block = _other.m_block;
+
+        return *this;
+    }
+
+    // Takes over the buffer of another array, leaving it empty.
+    dyn_array_cow &operator=(dyn_array_cow &&_other) noexcept
+    {
+        // Count the assignment
+        counted::operator=(std::move(_other));
+
+        if (this != &_other) {
+            release(m_block);
+            m_block        = _other.m_block;
+            _other.m_block = nullptr;
+        }
+
+        return *this;
+    }
+
+  public:
+    // Returns the number of elements.
+    size_t size() const
+    {
+        return m_block == nullptr ? 0 : m_block->size;
+    }
+
+    // Returns the elements for reading. Never copies.
+    const int *data() const
+    {
+        return m_block == nullptr ? nullptr : m_block->data();
+    }
+
+    // Returns an element for reading. Never copies.
+    const int &operator[](const size_t &_index) const
+    {
+        return m_block->data()[_index];
+    }
+
+    // Returns true if the buffer is shared with other arrays.
+    bool shared() const
+    {
+        return m_block != nullptr && !Refcount::unique(m_block->references);
+    }
+
+    /**
+     * Returns the elements for writing. If the buffer is shared, it is copied
+     * first (reported as deep copy). The pointer is valid until this array is
+     * copied, assigned or destroyed.
+     *
+     * @return The elements, owned exclusively by this array.
+     */
+    int *mutable_data()
+    {
+        if (shared()) {
+            // Report the deep copy before allocating (throws if the limit is
+            // exceeded)
+            counted::record_deep_copy(sizeof(int) * m_block->size);
+
+            // Materialize a private copy and drop the shared reference
+            block *copy = allocate(m_block->size);
+            std::memcpy(copy->data(), m_block->data(), sizeof(int) * m_block->size);
+
+            release(m_block);
+            m_block = copy;
+        }
+
+        return m_block == nullptr ? nullptr : m_block->data();
+    }
+
+  private:
+    // Allocates an unshared buffer with a given number of elements.
+    static block *allocate(const size_t &_size)
+    {
+        // The elements follow the header, which is at least int-aligned
+        static_assert(sizeof(block) % alignof(int) == 0);
+
+        void  *memory = ::operator new(sizeof(block) + sizeof(int) * _size);
+        block *ret    = new (memory) block{};
+
+        ret->references = 1;
+        ret->size       = _size;
+
+        return ret;
+    }
+
+    // Drops a reference to a buffer and frees it if it was the last one.
+    static void release(block *_block)
+    {
+        if (_block != nullptr && Refcount::decrement(_block->references)) {
+            _block->~block();
+            ::operator delete(_block);
+        }
+    }
+};
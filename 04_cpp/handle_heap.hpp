@@ -0,0 +1,454 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * A relocatable heap (POSIX only). Allocations return handles instead of
+ * pointers, so the heap can move blocks and slide them together (compaction).
+ * Freed space therefore does not fragment the heap: after compaction the used
+ * part of the heap is about as large as the live data and the pages behind it
+ * are returned to the operating system (MADV_DONTNEED).
+ *
+ * New blocks are always placed at the top of the heap (bump allocation). If
+ * the heap is exhausted, allocate() compacts it completely and retries.
+ *
+ * To access a block, pin it (preferably using pin_guard). Pinned blocks are
+ * not moved, all other pointers into the heap become invalid whenever the heap
+ * is compacted. Pin blocks only for short access windows, pinned blocks keep
+ * the space in front of them from being reclaimed.
+ *
+ * All members are thread-safe. Compaction can be performed incrementally by
+ * calling compact_step() or by a background thread (start_compactor()).
+ */
+class handle_heap {
+  public:
+    // Identifies a block. Handles of freed blocks may be reused.
+    using handle = size_t;
+
+    // Never returned by allocate().
+    static constexpr handle null_handle{static_cast<handle>(-1)};
+
+    // Statistics about the heap.
+    struct statistics {
+        size_t live_bytes;
+        size_t live_blocks;
+        size_t heap_bytes;
+        size_t moved_bytes;
+        size_t compactions;
+
+        // Returns the share of the used heap not occupied by live blocks.
+        double fragmentation() const
+        {
+            return heap_bytes == 0 ? 0. : 1. - static_cast<double>(live_bytes) / static_cast<double>(heap_bytes);
+        }
+    };
+
+    /**
+     * Pins a block for its lifetime and offers access to it.
+     *
+     * @tparam T The type of the elements stored in the block.
+     */
+    template <typename T>
+    class pin_guard {
+      private:
+        // The heap the block belongs to.
+        handle_heap &m_heap;
+
+        // The pinned block.
+        handle m_handle;
+
+        // The elements of the block.
+        T *m_data;
+
+      public:
+        // Pins a block.
+        pin_guard(handle_heap &_heap, const handle &_handle) :
+            m_heap{_heap}, m_handle{_handle}, m_data{static_cast<T *>(_heap.pin(_handle))}
+        {
+        }
+
+        // Unpins the block.
+        ~pin_guard()
+        {
+            m_heap.unpin(m_handle);
+        }
+
+        pin_guard(const pin_guard &)            = delete;
+        pin_guard &operator=(const pin_guard &) = delete;
+
+        // Returns the elements, valid as long as this guard exists.
+        T *data() const
+        {
+            return m_data;
+        }
+
+        // Returns an element.
+        T &operator[](const size_t &_index) const
+        {
+            return m_data[_index];
+        }
+    };
+
+  private:
+    // The header in front of every block in the heap.
+    struct block_header {
+        // The handle of the block or null_handle if it was freed.
+        handle owner;
+
+        // The size of the block including the header.
+        size_t size;
+    };
+
+    // An entry of the handle table.
+    struct entry {
+        size_t offset;
+        size_t size;
+        size_t pins;
+    };
+
+    // Blocks are aligned to the size of the header.
+    static constexpr size_t s_alignment{sizeof(block_header)};
+
+  private:
+    // Protects all members below.
+    mutable std::mutex m_mutex{};
+
+    // The reserved address range.
+    unsigned char *m_region{nullptr};
+
+    // The size of the reserved address range.
+    size_t m_capacity{0};
+
+    // The end of the last block.
+    size_t m_top{0};
+
+    // The highest top since pages were last released.
+    size_t m_high_water{0};
+
+    // The handle table, indexed by handle.
+    std::vector<entry> m_entries{};
+
+    // Handles that can be reused.
+    std::vector<handle> m_free_handles{};
+
+    // The next block examined by the current compaction (0 if none runs).
+    size_t m_scan{0};
+
+    // The destination of the next block moved by the current compaction.
+    size_t m_write{0};
+
+    // The statistics.
+    statistics m_stats{};
+
+    // The background compactor.
+    std::thread             m_compactor{};
+    std::condition_variable m_compactor_wakeup{};
+    bool                    m_compactor_stop{false};
+
+  public:
+    /**
+     * Reserves address space for the heap. Memory is only used once touched.
+     *
+     * @param _capacity The maximum number of bytes the heap can hold.
+     */
+    explicit handle_heap(const size_t &_capacity)
+    {
+        m_capacity = round_up(_capacity, page_size());
+
+        void *memory = ::mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw std::system_error{errno, std::generic_category(), "mmap"};
+        }
+
+        m_region = static_cast<unsigned char *>(memory);
+    }
+
+    // Stops the compactor and unmaps the heap. All blocks are freed.
+    ~handle_heap()
+    {
+        stop_compactor();
+        ::munmap(m_region, m_capacity);
+    }
+
+    handle_heap(const handle_heap &)            = delete;
+    handle_heap &operator=(const handle_heap &) = delete;
+
+  public:
+    /**
+     * Allocates a block. Compacts the heap if it is exhausted.
+     *
+     * @param _bytes The size of the block.
+     * @return The handle of the block.
+     * @throws std::bad_alloc If the heap cannot hold the block.
+     */
+    handle allocate(const size_t &_bytes)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if (_bytes > m_capacity) {
+            throw std::bad_alloc{};
+        }
+
+        const size_t size = sizeof(block_header) + round_up(_bytes, s_alignment);
+
+        // Reclaim free space if the heap is full
+        if (size > m_capacity - m_top) {
+            while (!compact_step_locked(static_cast<size_t>(-1))) {
+            }
+
+            if (size > m_capacity - m_top) {
+                throw std::bad_alloc{};
+            }
+        }
+
+        // Obtain a handle
+        handle ret;
+        if (m_free_handles.empty()) {
+            ret = m_entries.size();
+            m_entries.push_back({});
+        } else {
+            ret = m_free_handles.back();
+            m_free_handles.pop_back();
+        }
+
+        // Place the block at the top
+        header_at(m_top) = {ret, size};
+        m_entries[ret]   = {m_top, _bytes, 0};
+
+        m_top += size;
+        m_high_water = std::max(m_high_water, m_top);
+
+        // Update the statistics
+        m_stats.live_bytes += _bytes;
+        m_stats.heap_bytes = m_top;
+        ++m_stats.live_blocks;
+
+        return ret;
+    }
+
+    /**
+     * Frees a block. Its space is reclaimed by the next compaction.
+     *
+     * @param _handle The handle of the block, has to be unpinned.
+     */
+    void deallocate(const handle &_handle)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        // Mark the block as free
+        const entry &e            = m_entries[_handle];
+        header_at(e.offset).owner = null_handle;
+
+        m_stats.live_bytes -= e.size;
+        --m_stats.live_blocks;
+
+        m_free_handles.push_back(_handle);
+    }
+
+    /**
+     * Pins a block. It is not moved until unpin() is called as often as pin().
+     *
+     * @param _handle The handle of the block.
+     * @return The address of the block.
+     */
+    void *pin(const handle &_handle)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        entry &e = m_entries[_handle];
+        ++e.pins;
+        return m_region + e.offset + sizeof(block_header);
+    }
+
+    /**
+     * Unpins a block pinned by pin().
+     *
+     * @param _handle The handle of the block.
+     */
+    void unpin(const handle &_handle)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        --m_entries[_handle].pins;
+    }
+
+    /**
+     * Pins a block for the lifetime of the returned guard.
+     *
+     * @param _handle The handle of the block.
+     * @tparam T The type of the elements stored in the block.
+     * @return The guard.
+     */
+    template <typename T>
+    pin_guard<T> pinned(const handle &_handle)
+    {
+        return pin_guard<T>{*this, _handle};
+    }
+
+    // Returns the size of a block as requested by allocate().
+    size_t size(const handle &_handle) const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_entries[_handle].size;
+    }
+
+    /**
+     * Performs a bounded amount of compaction work. Blocks are slid towards the
+     * beginning of the heap in address order, pinned blocks stay in place. When
+     * the end of the heap is reached, the pages behind the last block are
+     * released.
+     *
+     * @param _max_bytes The number of bytes that may be moved (at least one
+     * block is moved).
+     * @return true if a compaction was completed by this call.
+     */
+    bool compact_step(const size_t &_max_bytes)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return compact_step_locked(_max_bytes);
+    }
+
+    /**
+     * Starts a thread compacting the heap whenever its fragmentation exceeds a
+     * threshold. The lock is released between steps, so allocations proceed
+     * while a compaction runs.
+     *
+     * @param _max_fragmentation The share of the heap that may be unused.
+     * @param _interval The time between two checks.
+     * @param _step_bytes The number of bytes moved per step.
+     */
+    void start_compactor(const double &_max_fragmentation, const std::chrono::milliseconds &_interval, const size_t &_step_bytes = 1 << 20)
+    {
+        stop_compactor();
+
+        m_compactor_stop = false;
+        m_compactor      = std::thread{[this, _max_fragmentation, _interval, _step_bytes]() {
+            std::unique_lock<std::mutex> lock{m_mutex};
+
+            while (!m_compactor_wakeup.wait_for(lock, _interval, [this]() { return m_compactor_stop; })) {
+                // Compact step by step, giving other threads a chance in between
+                if (m_scan != 0 || m_stats.fragmentation() > _max_fragmentation) {
+                    while (!m_compactor_stop && !compact_step_locked(_step_bytes)) {
+                        lock.unlock();
+                        std::this_thread::yield();
+                        lock.lock();
+                    }
+                }
+            }
+        }};
+    }
+
+    // Stops the thread started by start_compactor().
+    void stop_compactor()
+    {
+        if (!m_compactor.joinable()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_compactor_stop = true;
+        }
+
+        m_compactor_wakeup.notify_all();
+        m_compactor.join();
+    }
+
+    // Returns the current statistics.
+    statistics stats() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_stats;
+    }
+
+  private:
+    // See compact_step(), m_mutex has to be locked.
+    bool compact_step_locked(const size_t &_max_bytes)
+    {
+        size_t moved = 0;
+
+        while (m_scan < m_top) {
+            block_header &header = header_at(m_scan);
+            const size_t  size   = header.size;
+
+            if (header.owner == null_handle) {
+                // Skip freed blocks
+            } else if (m_entries[header.owner].pins != 0) {
+                // Pinned blocks stay, turn the gap in front into a free block
+                if (m_write != m_scan) {
+                    header_at(m_write) = {null_handle, m_scan - m_write};
+                }
+                m_write = m_scan + size;
+            } else {
+                // Stop if the budget is used up (but move at least one block)
+                if (moved != 0 && moved + size > _max_bytes) {
+                    return false;
+                }
+
+                if (m_write != m_scan) {
+                    m_entries[header.owner].offset = m_write;
+                    std::memmove(m_region + m_write, m_region + m_scan, size);
+
+                    moved += size;
+                    m_stats.moved_bytes += size;
+                }
+                m_write += size;
+            }
+
+            m_scan += size;
+        }
+
+        // Everything behind the last block is free
+        m_top = m_write;
+
+        // Release the pages behind the last block
+        const size_t first_page = round_up(m_top, page_size());
+        const size_t last_page  = round_up(m_high_water, page_size());
+        if (first_page < last_page) {
+            ::madvise(m_region + first_page, last_page - first_page, MADV_DONTNEED);
+        }
+
+        m_high_water = m_top;
+        m_scan       = 0;
+        m_write      = 0;
+
+        m_stats.heap_bytes = m_top;
+        ++m_stats.compactions;
+
+        return true;
+    }
+
+    // Returns the header of the block at a given offset.
+    block_header &header_at(const size_t &_offset)
+    {
+        return *reinterpret_cast<block_header *>(m_region + _offset);
+    }
+
+    // Returns the size of a page.
+    static size_t page_size()
+    {
+        static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    // Rounds a number up to a multiple of a power of two.
+    static size_t round_up(const size_t &_value, const size_t &_multiple)
+    {
+        return (_value + _multiple - 1) & ~(_multiple - 1);
+    }
+};
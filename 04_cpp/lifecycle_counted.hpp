@@ -0,0 +1,332 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <utility>
+
+// Enable lifecycle instrumentation by defining TRACK_LIFECYCLE (e.g. using the
+// build system). Without it lifecycle::counted is an empty base class and all
+// hooks compile to nothing.
+
+// Helpers to create a unique variable name per line
+#define LIFECYCLE_CONCAT_IMPL(_a, _b) _a##_b
+#define LIFECYCLE_CONCAT(_a, _b)      LIFECYCLE_CONCAT_IMPL(_a, _b)
+
+#ifdef TRACK_LIFECYCLE
+// Attributes all lifecycle events of the current thread to this line until the
+// end of the enclosing scope.
+#    define LIFECYCLE_SITE() \
+        lifecycle::site_scope LIFECYCLE_CONCAT(_lifecycle_site_, __LINE__)(__FILE__, __LINE__)
+#else
+// Evaluates to nothing. No action performed.
+#    define LIFECYCLE_SITE() static_cast<void>(0)
+#endif
+
+namespace lifecycle {
+
+// What happens if a single deep copy exceeds the configured limit.
+enum class limit_action {
+    // Write a line to std::cerr and continue.
+    report,
+
+    // Throw a std::length_error from the copying operation.
+    raise,
+
+    // Write a line to std::cerr and call std::abort (useful in tests).
+    abort
+};
+
+// The observed lifecycle events of a type at a given call site.
+struct counters {
+    size_t constructions{0};
+    size_t copies{0};
+    size_t moves{0};
+    size_t copy_assignments{0};
+    size_t move_assignments{0};
+    size_t destructions{0};
+    size_t bytes_copied{0};
+    size_t largest_copy{0};
+
+    // Adds the values of another counters object to this one.
+    counters &operator+=(const counters &_other)
+    {
+        constructions += _other.constructions;
+        copies += _other.copies;
+        moves += _other.moves;
+        copy_assignments += _other.copy_assignments;
+        move_assignments += _other.move_assignments;
+        destructions += _other.destructions;
+        bytes_copied += _other.bytes_copied;
+        largest_copy = largest_copy < _other.largest_copy ? _other.largest_copy : largest_copy;
+        return *this;
+    }
+};
+
+// Describes the place events are attributed to.
+struct site {
+    const char *file;
+    size_t      line;
+};
+
+// Marks the current thread as executing a given call site until the object is
+// destroyed. Scopes can be nested, the innermost one wins.
+class site_scope {
+  private:
+    // The currently active site of this thread.
+    static inline thread_local site s_current{"<unattributed>", 0};
+
+    // The site that was active before this scope was entered.
+    site m_previous;
+
+  public:
+    // Enters a new call site.
+    site_scope(const char *_file, const size_t &_line) :
+        m_previous{s_current}
+    {
+        s_current = {_file, _line};
+    }
+
+    // Restores the previous call site.
+    ~site_scope()
+    {
+        s_current = m_previous;
+    }
+
+    site_scope(const site_scope &)            = delete;
+    site_scope &operator=(const site_scope &) = delete;
+
+    // Returns the currently active site of this thread.
+    static const site &current()
+    {
+        return s_current;
+    }
+};
+
+#ifdef TRACK_LIFECYCLE
+
+/**
+ * A mixin that counts the lifecycle events of the deriving type T per call
+ * site. Derive from it (CRTP) and explicitly call its copy/move constructors
+ * and assignment operators from the corresponding members of T. Deep copies
+ * have to be reported by T using record_deep_copy().
+ *
+ * @tparam T The type that derives from this class.
+ */
+template <typename T>
+class counted {
+  private:
+    // The events grouped by call site (file and line).
+    static inline std::map<std::pair<std::string, size_t>, counters> s_sites{};
+
+    // Protects s_sites and the limit settings.
+    static inline std::mutex s_mutex{};
+
+    // Copies larger than this number of bytes trigger s_limit_action.
+    static inline size_t s_copy_limit{static_cast<size_t>(-1)};
+
+    // The action performed if a copy exceeds s_copy_limit.
+    static inline limit_action s_limit_action{limit_action::report};
+
+  private:
+    // Applies _update to the counters of the currently active call site.
+    template <typename F>
+    static void record(F _update)
+    {
+        const site &current = site_scope::current();
+
+        std::lock_guard<std::mutex> lock{s_mutex};
+        _update(s_sites[{current.file, current.line}]);
+    }
+
+    // Like record(), but drops the event instead of throwing (e.g. if the map
+    // cannot allocate). Used by the hooks that have to stay noexcept.
+    template <typename F>
+    static void record_nothrow(F _update) noexcept
+    {
+        try {
+            record(_update);
+        } catch (...) {
+        }
+    }
+
+  protected:
+    counted()
+    {
+        record([](counters &_c) { ++_c.constructions; });
+    }
+
+    counted(const counted &)
+    {
+        record([](counters &_c) { ++_c.copies; });
+    }
+
+    counted(counted &&) noexcept
+    {
+        record_nothrow([](counters &_c) { ++_c.moves; });
+    }
+
+    ~counted()
+    {
+        record_nothrow([](counters &_c) { ++_c.destructions; });
+    }
+
+    counted &operator=(const counted &)
+    {
+        record([](counters &_c) { ++_c.copy_assignments; });
+        return *this;
+    }
+
+    counted &operator=(counted &&) noexcept
+    {
+        record_nothrow([](counters &_c) { ++_c.move_assignments; });
+        return *this;
+    }
+
+    /**
+     * Reports that a copy constructor or copy assignment of T duplicated a
+     * given number of bytes. Checks the configured copy limit.
+     *
+     * @param _bytes The number of bytes that were copied.
+     */
+    static void record_deep_copy(const size_t &_bytes)
+    {
+        record([&_bytes](counters &_c) {
+            _c.bytes_copied += _bytes;
+            _c.largest_copy = _c.largest_copy < _bytes ? _bytes : _c.largest_copy;
+        });
+
+        size_t       limit;
+        limit_action action;
+        {
+            std::lock_guard<std::mutex> lock{s_mutex};
+            limit  = s_copy_limit;
+            action = s_limit_action;
+        }
+
+        // Nothing to do if the copy is within the limit
+        if (_bytes <= limit) {
+            return;
+        }
+
+        const site &current = site_scope::current();
+        std::string message{std::string{"Copy of "} + typeid(T).name() + " in " + current.file + ":" + std::to_string(current.line) + " copied " + std::to_string(_bytes) + " bytes (limit " + std::to_string(limit) + ")."};
+
+        switch (action) {
+            case limit_action::report:
+                std::cerr << message << "\n";
+                break;
+            case limit_action::raise:
+                throw std::length_error{message};
+            case limit_action::abort:
+                std::cerr << message << "\n";
+                std::abort();
+        }
+    }
+
+  public:
+    /**
+     * Sets the maximum number of bytes a single deep copy may duplicate.
+     *
+     * @param _bytes The maximum number of bytes.
+     * @param _action The action performed if a copy exceeds the limit.
+     */
+    static void set_copy_limit(const size_t &_bytes, const limit_action &_action)
+    {
+        std::lock_guard<std::mutex> lock{s_mutex};
+        s_copy_limit   = _bytes;
+        s_limit_action = _action;
+    }
+
+    // Returns the events summed up over all call sites.
+    static counters totals()
+    {
+        std::lock_guard<std::mutex> lock{s_mutex};
+
+        counters ret{};
+        for (const auto &val : s_sites) {
+            ret += val.second;
+        }
+
+        return ret;
+    }
+
+    // Forgets all observed events.
+    static void reset()
+    {
+        std::lock_guard<std::mutex> lock{s_mutex};
+        s_sites.clear();
+    }
+
+    /**
+     * Writes the observed events grouped by call site.
+     *
+     * @param _out The stream the report is written to.
+     */
+    static void report(std::ostream &_out)
+    {
+        std::lock_guard<std::mutex> lock{s_mutex};
+
+        _out << "Lifecycle of " << typeid(T).name() << ":\n";
+        for (const auto &val : s_sites) {
+            const counters &c = val.second;
+            _out << "  " << val.first.first << ":" << val.first.second
+                 << ": constructions=" << c.constructions
+                 << " copies=" << c.copies
+                 << " moves=" << c.moves
+                 << " copy_assignments=" << c.copy_assignments
+                 << " move_assignments=" << c.move_assignments
+                 << " destructions=" << c.destructions
+                 << " bytes_copied=" << c.bytes_copied
+                 << " largest_copy=" << c.largest_copy << "\n";
+        }
+    }
+};
+
+#else
+
+// Disabled variant of the mixin. Empty, so it does not add to the size of T.
+template <typename T>
+class counted {
+  protected:
+    counted()                           = default;
+    counted(const counted &)            = default;
+    counted(counted &&)                 = default;
+    ~counted()                          = default;
+    counted &operator=(const counted &) = default;
+    counted &operator=(counted &&)      = default;
+
+    // No action performed.
+    static void record_deep_copy(const size_t &) {}
+
+  public:
+    // No action performed.
+    static void set_copy_limit(const size_t &, const limit_action &) {}
+
+    // Returns empty counters.
+    static counters totals()
+    {
+        return {};
+    }
+
+    // No action performed.
+    static void reset() {}
+
+    // Writes a note that the instrumentation is disabled.
+    static void report(std::ostream &_out)
+    {
+        _out << "Lifecycle of " << typeid(T).name() << ": disabled (define TRACK_LIFECYCLE).\n";
+    }
+};
+
+#endif
+
+} // namespace lifecycle
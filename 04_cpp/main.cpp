@@ -1,6 +1,10 @@
 // SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
 // SPDX-License-Identifier: MIT
 
+#include "buffer_cache.hpp"
+#include "dyn_array_cow.hpp"
+#include "lifecycle_counted.hpp"
+
 #include <cstring>
 #include <iostream>
 #include <memory>
@@ -53,7 +57,7 @@ void showcase_object_lifecycle()
 }
 
 // A dynamic array without implementing move operators
-struct dyn_array {
+struct dyn_array : lifecycle::counted<dyn_array> {
   public:
     // The array size
     size_t size;
@@ -85,10 +89,14 @@ dyn_array::dyn_array(const size_t &_size)
     data = new int[size];
 }
 
-dyn_array::dyn_array(const dyn_array &_other)
+dyn_array::dyn_array(const dyn_array &_other) :
+    lifecycle::counted<dyn_array>{_other}
 {
     std::cout << "  Copy-Constructor\n";
 
+    // Report the deep copy before allocating (throws if the limit is exceeded)
+    record_deep_copy(sizeof(int) * _other.size);
+
     // Create array of same size as other
     size = _other.size;
     data = new int[size];
@@ -109,6 +117,13 @@ dyn_array &dyn_array::operator=(const dyn_array &_other)
 {
     std::cout << "  Assignment-Operator\n";
 
+    // Count the assignment
+    lifecycle::counted<dyn_array>::operator=(_other);
+
+    // Report the deep copy before modifying this (throws if the limit is
+    // exceeded)
+    record_deep_copy(sizeof(int) * _other.size);
+
     // Delete dynamically allocated array of this object before overwriting
     delete[] data;
 
@@ -165,6 +180,9 @@ void showcase_copy_constructor_problems()
     // Initialize pseudo random function
     srand(time(0));
 
+    // Attribute the lifecycle events of the call below to this line
+    LIFECYCLE_SITE();
+
     // Call generate array. Notice how the copy constructor is called (though)
     // technically not necessary
     dyn_array x = generate_dyn_array();
@@ -173,7 +191,7 @@ void showcase_copy_constructor_problems()
 }
 
 // A dynamic array
-struct dyn_array_move {
+struct dyn_array_move : lifecycle::counted<dyn_array_move> {
   public:
     // The array size
     size_t size;
@@ -200,30 +218,62 @@ struct dyn_array_move {
 
     // Move-Assigns this object to another dyn_array object.
     dyn_array_move &operator=(dyn_array_move &&_other);
+
+  private:
+    // Allocates an array of a given size (reuses a cached buffer if
+    // USE_BUFFER_CACHE is defined).
+    static int *allocate(const size_t &_size);
+
+    // Deallocates an array obtained by allocate().
+    static void deallocate(int *_data, const size_t &_size);
 };
 
+int *dyn_array_move::allocate(const size_t &_size)
+{
+#ifdef USE_BUFFER_CACHE
+    return buffer_cache<int>::acquire(_size);
+#else
+    return new int[_size];
+#endif
+}
+
+void dyn_array_move::deallocate(int *_data, const size_t &_size)
+{
+#ifdef USE_BUFFER_CACHE
+    buffer_cache<int>::release(_data, _size);
+#else
+    static_cast<void>(_size);
+    delete[] _data;
+#endif
+}
+
 dyn_array_move::dyn_array_move(const size_t &_size)
 {
     std::cout << "  Constructor\n";
 
     // Create array of specified size
     size = _size;
-    data = new int[size];
+    data = allocate(size);
 }
 
-dyn_array_move::dyn_array_move(const dyn_array_move &_other)
+dyn_array_move::dyn_array_move(const dyn_array_move &_other) :
+    lifecycle::counted<dyn_array_move>{_other}
 {
     std::cout << "  Copy-Constructor\n";
 
+    // Report the deep copy before allocating (throws if the limit is exceeded)
+    record_deep_copy(sizeof(int) * _other.size);
+
     // Create array of same size as other
     size = _other.size;
-    data = new int[size];
+    data = allocate(size);
 
     // Copy contents of previous array
     std::memcpy(data, _other.data, sizeof(int) * size);
 }
 
-dyn_array_move::dyn_array_move(dyn_array_move &&_other)
+dyn_array_move::dyn_array_move(dyn_array_move &&_other) :
+    lifecycle::counted<dyn_array_move>{std::move(_other)}
 {
     std::cout << "  Move-Constructor\n";
 
@@ -241,19 +291,26 @@ dyn_array_move::~dyn_array_move()
     std::cout << "  Destructor\n";
 
     // Delete dynamically allocated array
-    delete[] data;
+    deallocate(data, size);
 }
 
 dyn_array_move &dyn_array_move::operator=(const dyn_array_move &_other)
 {
     std::cout << "  Assignment-Operator\n";
 
+    // Count the assignment
+    lifecycle::counted<dyn_array_move>::operator=(_other);
+
+    // Report the deep copy before modifying this (throws if the limit is
+    // exceeded)
+    record_deep_copy(sizeof(int) * _other.size);
+
     // Delete dynamically allocated array of this object before overwriting
-    delete[] data;
+    deallocate(data, size);
 
     // Create array of same size as other
     size = _other.size;
-    data = new int[size];
+    data = allocate(size);
 
     // Copy contents of previous array
     std::memcpy(data, _other.data, sizeof(int) * size);
@@ -266,8 +323,11 @@ dyn_array_move &dyn_array_move::operator=(dyn_array_move &&_other)
 {
     std::cout << "  Move-Assignment-Operator\n";
 
+    // Count the assignment
+    lifecycle::counted<dyn_array_move>::operator=(std::move(_other));
+
     // Delete dynamically allocated array of this object before overwriting
-    delete[] data;
+    deallocate(data, size);
 
     // Move contents of other
     this->size = _other.size;
@@ -302,6 +362,9 @@ void showcase_rule_of_five()
     // Initialize pseudo random function
     srand(time(0));
 
+    // Attribute the lifecycle events of the call below to this line
+    LIFECYCLE_SITE();
+
     // Call generate array. Notice how the copy constructor is not called but
     // instead the move constructor is used.
     dyn_array_move x = generate_dyn_array_move();
@@ -309,6 +372,62 @@ void showcase_rule_of_five()
     std::cout << "  x.size: " << x.size << "\n";
 }
 
+// Shows how copy-on-write arrays share their buffer until one is modified.
+void showcase_copy_on_write()
+{
+    std::cout << "showcase_copy_on_write()\n";
+
+    // Attribute the lifecycle events below to this line
+    LIFECYCLE_SITE();
+
+    // Create and fill an array
+    dyn_array_cow<> a{1000};
+    std::memset(a.mutable_data(), 0, sizeof(int) * a.size());
+
+    // Copies only increment the reference count
+    dyn_array_cow<> b{a};
+    dyn_array_cow<> c{b};
+    std::cout << "  a shared: " << a.shared() << ", a and c share data: " << (a.data() == c.data()) << "\n";
+
+    // The first write to c copies the buffer, a and b are unaffected
+    c.mutable_data()[0] = 42;
+    std::cout << "  a and c share data: " << (a.data() == c.data()) << ", a[0]: " << a[0] << ", c[0]: " << c[0] << "\n";
+
+    // Without atomic reference counting if all copies stay on this thread
+    dyn_array_cow<refcount::single_thread> d{10};
+    dyn_array_cow<refcount::single_thread> e{d};
+    std::cout << "  d shared: " << d.shared() << ", e size: " << e.size() << "\n";
+}
+
+// Shows how the lifecycle instrumentation reveals hidden copies. Build with
+// TRACK_LIFECYCLE defined (target 04_cpp_lifecycle) to see actual numbers.
+void showcase_lifecycle_tracking()
+{
+    std::cout << "showcase_lifecycle_tracking()\n";
+
+    // Summarize the events of the previous showcases
+    lifecycle::counted<dyn_array>::report(std::cout);
+    lifecycle::counted<dyn_array_move>::report(std::cout);
+    lifecycle::counted<dyn_array_cow<>>::report(std::cout);
+
+    // Treat every copy above 64 bytes as an error
+    lifecycle::counted<dyn_array>::set_copy_limit(64, lifecycle::limit_action::raise);
+
+    try {
+        LIFECYCLE_SITE();
+
+        // Copying 10 ints stays below the limit, copying 20 ints does not
+        dyn_array small{10}, large{20};
+        dyn_array small_copy{small};
+        dyn_array large_copy{large};
+    } catch (const std::length_error &_e) {
+        std::cerr << "  " << _e.what() << "\n";
+    }
+
+    // Restore default behavior
+    lifecycle::counted<dyn_array>::set_copy_limit(static_cast<size_t>(-1), lifecycle::limit_action::report);
+}
+
 void showcase_unique_ptr()
 {
     std::cout << "showcase_unique_ptr()\n";
@@ -371,6 +490,8 @@ int main()
     showcase_rule_of_three();
     showcase_copy_constructor_problems();
     showcase_rule_of_five();
+    showcase_copy_on_write();
+    showcase_lifecycle_tracking();
     showcase_unique_ptr();
     showcase_shared_and_weak_ptr();
 
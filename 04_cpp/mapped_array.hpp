@@ -0,0 +1,300 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * A dynamic array backed by a memory mapped file (POSIX only). Offers the same
+ * members as dyn_array_move (size and data), but the elements live in the page
+ * cache instead of the heap. Pages are read on first access and written back
+ * by the kernel, so the array may be larger than the available memory.
+ *
+ * The array is move-only. Errors are reported by throwing std::system_error.
+ *
+ * @tparam T The element type, has to be trivially copyable.
+ */
+template <typename T = int>
+class mapped_array {
+    static_assert(std::is_trivially_copyable_v<T>, "mapped_array stores the raw bytes of T in a file");
+
+  public:
+    // How the file is opened.
+    enum class open_mode {
+        // Opens an existing file for reading, writing to data is undefined.
+        read_only,
+        // Opens an existing file for reading and writing.
+        read_write,
+        // Creates (or truncates) a file with a given number of elements.
+        create
+    };
+
+    // The expected access pattern, used by the kernel to tune read-ahead.
+    enum class access_pattern {
+        normal,
+        sequential,
+        random
+    };
+
+    // Whether flush() waits for the write-back.
+    enum class flush_mode {
+        sync,
+        async
+    };
+
+  public:
+    // The array size
+    size_t size{0};
+
+    // The array data
+    T *data{nullptr};
+
+  private:
+    // The file descriptor of the backing file.
+    int m_file{-1};
+
+    // The number of mapped bytes.
+    size_t m_bytes{0};
+
+    // The first element not yet requested by read_ahead().
+    size_t m_read_ahead_end{0};
+
+  public:
+    /**
+     * Maps a file.
+     *
+     * @param _path The path of the file.
+     * @param _mode How the file is opened.
+     * @param _size The number of elements if the file is created. Otherwise the
+     * size is determined by the file size.
+     */
+    mapped_array(const std::string &_path, const open_mode &_mode, const size_t &_size = 0)
+    {
+        const int flags = _mode == open_mode::read_only ? O_RDONLY : (_mode == open_mode::read_write ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC);
+
+        m_file = ::open(_path.c_str(), flags, 0644);
+        if (m_file == -1) {
+            throw std::system_error{errno, std::generic_category(), "open " + _path};
+        }
+
+        try {
+            // Determine or set the size of the file
+            if (_mode == open_mode::create) {
+                size    = _size;
+                m_bytes = sizeof(T) * _size;
+
+                if (::ftruncate(m_file, static_cast<off_t>(m_bytes)) == -1) {
+                    throw std::system_error{errno, std::generic_category(), "ftruncate " + _path};
+                }
+            } else {
+                struct stat info;
+                if (::fstat(m_file, &info) == -1) {
+                    throw std::system_error{errno, std::generic_category(), "fstat " + _path};
+                }
+
+                size    = static_cast<size_t>(info.st_size) / sizeof(T);
+                m_bytes = sizeof(T) * size;
+            }
+
+            // Empty mappings are not allowed
+            if (m_bytes != 0) {
+                const int protection = _mode == open_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+
+                void *memory = ::mmap(nullptr, m_bytes, protection, MAP_SHARED, m_file, 0);
+                if (memory == MAP_FAILED) {
+                    throw std::system_error{errno, std::generic_category(), "mmap " + _path};
+                }
+
+                data = static_cast<T *>(memory);
+            }
+        } catch (...) {
+            ::close(m_file);
+            throw;
+        }
+    }
+
+    // Takes over the mapping of another array, leaving it empty.
+    mapped_array(mapped_array &&_other) noexcept :
+        size{_other.size}, data{_other.data}, m_file{_other.m_file}, m_bytes{_other.m_bytes}, m_read_ahead_end{_other.m_read_ahead_end}
+    {
+        _other.release();
+    }
+
+    // Unmaps the file. Modified pages are still written back by the kernel,
+    // call flush() to wait for that.
+    ~mapped_array()
+    {
+        unmap();
+    }
+
+    mapped_array(const mapped_array &)            = delete;
+    mapped_array &operator=(const mapped_array &) = delete;
+
+    // Takes over the mapping of another array, leaving it empty.
+    mapped_array &operator=(mapped_array &&_other) noexcept
+    {
+        if (this != &_other) {
+            unmap();
+
+            size             = _other.size;
+            data             = _other.data;
+            m_file           = _other.m_file;
+            m_bytes          = _other.m_bytes;
+            m_read_ahead_end = _other.m_read_ahead_end;
+
+            _other.release();
+        }
+
+        return *this;
+    }
+
+  public:
+    /**
+     * Tells the kernel how the whole array will be accessed (madvise).
+     *
+     * @param _pattern The expected access pattern.
+     */
+    void advise(const access_pattern &_pattern)
+    {
+        const int advice = _pattern == access_pattern::sequential ? MADV_SEQUENTIAL : (_pattern == access_pattern::random ? MADV_RANDOM : MADV_NORMAL);
+
+        if (m_bytes != 0 && ::madvise(data, m_bytes, advice) == -1) {
+            throw std::system_error{errno, std::generic_category(), "madvise"};
+        }
+    }
+
+    /**
+     * Asks the kernel to start reading a range of elements in the background
+     * (MADV_WILLNEED). Returns immediately.
+     *
+     * @param _first The first element.
+     * @param _count The number of elements.
+     */
+    void will_need(const size_t &_first, const size_t &_count)
+    {
+        advise_range(_first, _count, MADV_WILLNEED);
+    }
+
+    /**
+     * Keeps the background read-ahead a window ahead of a sequential scan.
+     * Call it with the current index as often as convenient: whenever the scan
+     * enters the last window requested, the next window is requested using
+     * will_need(), so reading overlaps with processing.
+     *
+     * @param _index The element currently processed.
+     * @param _window The number of elements per window.
+     */
+    void read_ahead(const size_t &_index, const size_t &_window)
+    {
+        // Restart if the scan jumped
+        if (_index + 2 * _window < m_read_ahead_end || _index >= m_read_ahead_end) {
+            m_read_ahead_end = _index;
+        }
+
+        // Stay at least one window ahead
+        while (m_read_ahead_end < size && m_read_ahead_end < _index + 2 * _window) {
+            will_need(m_read_ahead_end, _window);
+            m_read_ahead_end += _window;
+        }
+    }
+
+    /**
+     * Releases the pages of a range of elements that are not needed anymore
+     * (MADV_DONTNEED). Modified pages have to be flushed before, the next
+     * access reads them from the file again.
+     *
+     * @param _first The first element.
+     * @param _count The number of elements.
+     */
+    void dont_need(const size_t &_first, const size_t &_count)
+    {
+        advise_range(_first, _count, MADV_DONTNEED);
+    }
+
+    /**
+     * Writes modified elements back to the file (msync).
+     *
+     * @param _mode Whether to wait until the data is written (sync) or only
+     * schedule the write-back (async).
+     * @param _first The first element.
+     * @param _count The number of elements, all remaining by default.
+     */
+    void flush(const flush_mode &_mode = flush_mode::sync, const size_t &_first = 0, const size_t &_count = static_cast<size_t>(-1))
+    {
+        void  *begin;
+        size_t bytes;
+        if (!page_range(_first, _count, begin, bytes)) {
+            return;
+        }
+
+        if (::msync(begin, bytes, _mode == flush_mode::sync ? MS_SYNC : MS_ASYNC) == -1) {
+            throw std::system_error{errno, std::generic_category(), "msync"};
+        }
+    }
+
+  private:
+    // Applies madvise() to the pages covering a range of elements.
+    void advise_range(const size_t &_first, const size_t &_count, const int &_advice)
+    {
+        void  *begin;
+        size_t bytes;
+        if (page_range(_first, _count, begin, bytes) && ::madvise(begin, bytes, _advice) == -1) {
+            throw std::system_error{errno, std::generic_category(), "madvise"};
+        }
+    }
+
+    // Determines the pages covering a range of elements, clamped to the array.
+    // Returns false if the range is empty.
+    bool page_range(const size_t &_first, const size_t &_count, void *&_begin, size_t &_bytes) const
+    {
+        if (_first >= size || _count == 0) {
+            return false;
+        }
+
+        static const std::uintptr_t page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+
+        const size_t         last  = _first + std::min(_count, size - _first);
+        const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(data + _first) & ~(page - 1);
+        const std::uintptr_t end   = reinterpret_cast<std::uintptr_t>(data + last);
+
+        _begin = reinterpret_cast<void *>(begin);
+        _bytes = static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    // Unmaps the file and closes it.
+    void unmap()
+    {
+        if (data != nullptr) {
+            ::munmap(data, m_bytes);
+        }
+
+        if (m_file != -1) {
+            ::close(m_file);
+        }
+
+        release();
+    }
+
+    // Forgets the mapping without unmapping it.
+    void release()
+    {
+        size             = 0;
+        data             = nullptr;
+        m_file           = -1;
+        m_bytes          = 0;
+        m_read_ahead_end = 0;
+    }
+};
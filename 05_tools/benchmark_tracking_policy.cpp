@@ -0,0 +1,108 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "tracking_policy.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Prevents the compiler from removing an allocation that is never read.
+template <typename T>
+void escape(T *_ptr)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(_ptr) : "memory");
+#else
+    static T *volatile sink;
+    sink = _ptr;
+#endif
+}
+
+// Returns the nanoseconds per new[]/delete[] pair of the given callables.
+template <typename Allocate, typename Deallocate>
+double measure(const size_t &_iterations, Allocate _allocate, Deallocate _deallocate)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < _iterations; ++i) {
+        int *array = _allocate(16 + (i & 15));
+        escape(array);
+        _deallocate(array);
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(_iterations);
+}
+
+// Returns the nanoseconds per new[]/delete[] pair of a policy.
+template <typename Policy>
+double measure_policy(const size_t &_iterations)
+{
+    return measure(
+        _iterations,
+        [](const size_t &_amount) { return Policy::template new_array<int>(__FILE__, __LINE__, _amount); },
+        [](int *_array) { Policy::delete_array(__FILE__, __LINE__, _array); });
+}
+
+// Returns the median of a number of samples.
+double median(std::vector<double> _samples)
+{
+    std::sort(_samples.begin(), _samples.end());
+    return _samples[_samples.size() / 2];
+}
+
+// Compares the overhead of the tracking policies with raw new[]/delete[]. Set
+// MYOM_TRACK_ALLOCATIONS=1 to measure tracking::runtime while it is enabled.
+// Every policy is measured in several rounds, the order is rotated between
+// rounds so drifts (e.g. of the clock frequency) affect all policies alike.
+// The median and the minimum of the rounds are reported.
+int main()
+{
+    const size_t rounds     = 15;
+    const size_t iterations = 2000000;
+
+    // The measured variants, tracking::enabled gets fewer iterations
+    const char *const names[] = {"new[]/delete[]:    ", "tracking::disabled:", "tracking::runtime: ", "tracking::enabled: "};
+    const size_t      count   = sizeof(names) / sizeof(names[0]);
+
+    // Performs one pass of a variant
+    const auto pass = [iterations](const size_t &_variant) {
+        switch (_variant) {
+            case 0:
+                return measure(iterations, [](const size_t &_amount) { return new int[_amount]; }, [](int *_array) { delete[] _array; });
+            case 1:
+                return measure_policy<tracking::disabled>(iterations);
+            case 2:
+                return measure_policy<tracking::runtime>(iterations);
+            default:
+                return measure_policy<tracking::enabled>(iterations / 10);
+        }
+    };
+
+    // Warm up the allocator
+    measure(iterations, [](const size_t &_amount) { return new int[_amount]; }, [](int *_array) { delete[] _array; });
+
+    std::vector<std::vector<double>> samples(count);
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < count; ++i) {
+            const size_t variant = (round + i) % count;
+            samples[variant].push_back(pass(variant));
+        }
+    }
+
+    const double raw = median(samples[0]);
+    for (size_t i = 0; i < count; ++i) {
+        const double value = median(samples[i]);
+
+        std::cout << names[i] << " " << value << " ns median, " << *std::min_element(samples[i].begin(), samples[i].end()) << " ns min";
+        if (i != 0) {
+            std::cout << " (" << value - raw << " ns overhead" << (i == 2 ? (tracking::runtime::active() ? ", enabled" : ", disabled") : "") << ")";
+        }
+        std::cout << "\n";
+    }
+
+    return tracking::enabled::report_leaks();
+}
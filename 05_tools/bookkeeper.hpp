@@ -0,0 +1,171 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "heap_snapshot.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Example for a bookkeeper class. All public members are thread-safe.
+class bookkeeper {
+  private:
+    // A struct describing an allocation.
+    struct allocation_entry {
+        std::string file;
+        size_t      line;
+        size_t      chars;
+    };
+
+    // A struct describing a deallocation error.
+    struct deallocation_error {
+        std::string file;
+        size_t      line;
+    };
+
+  private:
+    // The leak scanner inspects the currently tracked allocations.
+    friend class leak_scanner;
+
+    // Information about the currently tracked allocated memory.
+    static inline std::map<void *, allocation_entry> s_allocated_memory{};
+
+    // Observed deallocation errors
+    static inline std::list<deallocation_error> s_deallocation_error{};
+
+    // Protects s_allocated_memory and s_deallocation_error.
+    static inline std::mutex s_mutex{};
+
+  public:
+    /**
+     * Allocates an array of type T and size _amount. The pointer is monitored
+     * by the bookkeeper and needs to be freed, otherwise a memory leak is
+     * reported.
+     *
+     * @param _file The file the allocation occurred in.
+     * @param _line The line the allocation occurred in.
+     * @param _amount The size of the array that should be allocated.
+     * @tparam T The type of the array that should be allocated.
+     * @return The result of new T[_amount].
+     */
+    template <typename T>
+    static T *alloc_array(const std::string &_file, const size_t &_line, const size_t &_amount)
+    {
+        // Allocate the requested array
+        T *alloced_array = new T[_amount];
+
+        // Calculate the number of allocated characters
+        const size_t alloced_chars{_amount * sizeof(T)};
+
+        // Keep track of allocated memory
+        std::lock_guard<std::mutex> lock{s_mutex};
+        s_allocated_memory.insert({static_cast<void *>(alloced_array), {_file, _line, alloced_chars}});
+
+        // Return allocated array
+        return alloced_array;
+    }
+
+    /**
+     * Deallocates a given array of type T, removing it from the books.
+     *
+     * @param _file The file the deallocation occurred in.
+     * @param _line The line the deallocation occurred in.
+     * @param _array The array that should be deallocated.
+     * @tparam T The type of the array that should be deallocated.
+     */
+    template <typename T>
+    static void dealloc_array(const std::string &_file, const size_t &_line, T *_array)
+    {
+        {
+            std::lock_guard<std::mutex> lock{s_mutex};
+
+            // Remove entry from books and if it was not present in the book ...
+            if (s_allocated_memory.erase(static_cast<void *>(_array)) == 0) {
+                // ... report an deallocation error.
+                s_deallocation_error.push_back({_file, _line});
+            }
+        }
+
+        // Free memory occupied by memory
+        delete[] _array;
+    }
+
+    /**
+     * Aggregates the currently tracked allocations by call site.
+     *
+     * @return The snapshot, sites sorted by bytes.
+     */
+    static heap_snapshot snapshot()
+    {
+        std::lock_guard<std::mutex> lock{s_mutex};
+        return snapshot_locked();
+    }
+
+    /**
+     * Reports any errors observed while performing allocations. Leaks and
+     * deallocation errors are aggregated by call site.
+     *
+     * @return EXIT_SUCCESS if no errors where encountered, EXIT_FAILURE
+     * otherwise.
+     */
+    static int report_leaks()
+    {
+        std::lock_guard<std::mutex> lock{s_mutex};
+
+        // Check if there is anything to report
+        if (s_allocated_memory.empty() && s_deallocation_error.empty()) {
+            return EXIT_SUCCESS;
+        }
+
+        // Show memory leaks.
+        if (!s_allocated_memory.empty()) {
+            std::cerr << "Leaks detected:\n";
+            snapshot_locked().print(std::cerr);
+        }
+
+        // Show unmonitored deallocations.
+        if (!s_deallocation_error.empty()) {
+            std::map<std::pair<std::string_view, size_t>, size_t> aggregated;
+            for (const auto &val : s_deallocation_error) {
+                ++aggregated[{val.file, val.line}];
+            }
+
+            std::string buffer;
+            for (const auto &val : aggregated) {
+                buffer += std::to_string(val.second) + " deallocation error(s) detected in " + std::string{val.first.first} + ":" + std::to_string(val.first.second) + ".\n";
+            }
+            std::cerr.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+
+        return EXIT_FAILURE;
+    }
+
+  private:
+    // See snapshot(), s_mutex has to be locked.
+    static heap_snapshot snapshot_locked()
+    {
+        // Aggregate without copying the file name of every entry
+        std::map<std::pair<std::string_view, size_t>, std::pair<size_t, size_t>> aggregated;
+        for (const auto &val : s_allocated_memory) {
+            auto &totals = aggregated[{val.second.file, val.second.line}];
+            ++totals.first;
+            totals.second += val.second.chars;
+        }
+
+        std::vector<heap_snapshot::site> sites;
+        sites.reserve(aggregated.size());
+        for (const auto &val : aggregated) {
+            sites.push_back({std::string{val.first.first}, val.first.second, val.second.first, val.second.second});
+        }
+
+        return heap_snapshot{std::move(sites)};
+    }
+};
@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "heap_snapshot.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Compares two heap snapshots and shows the call sites that changed, the one
+// growing most first.
+// Usage: 05_tools_heap_diff <before file> <after file> [max sites]
+int main(int _argc, char **_argv)
+{
+    if (_argc < 3) {
+        std::cerr << "Usage: " << _argv[0] << " <before file> <after file> [max sites]\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto before = heap_snapshot::load(_argv[1]);
+    const auto after  = heap_snapshot::load(_argv[2]);
+
+    if (!before || !after) {
+        std::cerr << "Could not read " << (before ? _argv[2] : _argv[1]) << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    const size_t max_sites = _argc > 3 ? std::strtoull(_argv[3], nullptr, 10) : 20;
+    const auto   deltas    = heap_snapshot::diff(*before, *after);
+
+    std::cout << "Change over " << static_cast<long long>(after->time) - static_cast<long long>(before->time) << " s: ";
+    std::cout << static_cast<long long>(after->total_bytes()) - static_cast<long long>(before->total_bytes()) << " bytes, ";
+    std::cout << static_cast<long long>(after->total_count()) - static_cast<long long>(before->total_count()) << " allocation(s).\n";
+    heap_snapshot::print(deltas, std::cout, max_sites);
+
+    return EXIT_SUCCESS;
+}
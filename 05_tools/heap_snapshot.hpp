@@ -0,0 +1,326 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * The live allocations of a process aggregated by call site. Sites are sorted
+ * by the number of bytes in descending order. Snapshots can be written to a
+ * compact binary file and compared with each other, e.g. to find the sites
+ * that keep growing in a long-running service.
+ *
+ * File format (native byte order):
+ *   char[8]  "MYOMSNAP"
+ *   uint32_t version
+ *   uint64_t time of capture (seconds since the epoch)
+ *   uint64_t number of sites
+ *   per site: uint32_t length of file name, file name, uint64_t line,
+ *             uint64_t count, uint64_t bytes
+ */
+class heap_snapshot {
+  public:
+    // The live allocations of one call site.
+    struct site {
+        std::string file;
+        size_t      line;
+        size_t      count;
+        size_t      bytes;
+    };
+
+    // The change of one call site between two snapshots.
+    struct site_delta {
+        std::string  file;
+        size_t       line;
+        std::int64_t count;
+        std::int64_t bytes;
+    };
+
+  private:
+    // Identifies the file format.
+    static constexpr char s_magic[8]{'M', 'Y', 'O', 'M', 'S', 'N', 'A', 'P'};
+
+    // The current version of the file format.
+    static constexpr std::uint32_t s_version{1};
+
+    // The number of characters collected before they are written to a stream.
+    static constexpr size_t s_buffer_size{64 * 1024};
+
+  public:
+    // The aggregated call sites, sorted by bytes.
+    std::vector<site> sites{};
+
+    // The time the snapshot was captured.
+    std::uint64_t time{0};
+
+  public:
+    heap_snapshot() = default;
+
+    /**
+     * Creates a snapshot from aggregated call sites.
+     *
+     * @param _sites The call sites, every site may only occur once.
+     */
+    explicit heap_snapshot(std::vector<site> _sites) : sites{std::move(_sites)}, time{static_cast<std::uint64_t>(std::time(nullptr))}
+    {
+        std::sort(sites.begin(), sites.end(), [](const site &_a, const site &_b) { return _a.bytes > _b.bytes; });
+    }
+
+    // Returns the number of live allocations.
+    size_t total_count() const
+    {
+        size_t ret{0};
+        for (const auto &val : sites) {
+            ret += val.count;
+        }
+        return ret;
+    }
+
+    // Returns the number of live bytes.
+    size_t total_bytes() const
+    {
+        size_t ret{0};
+        for (const auto &val : sites) {
+            ret += val.bytes;
+        }
+        return ret;
+    }
+
+    /**
+     * Writes one line per site, largest first. The lines are collected in a
+     * buffer, so even millions of allocations are written with a few calls.
+     *
+     * @param _out The stream the sites are written to.
+     * @param _max_sites The maximum number of sites written.
+     */
+    void print(std::ostream &_out, const size_t &_max_sites = static_cast<size_t>(-1)) const
+    {
+        std::string buffer;
+        buffer.reserve(s_buffer_size + 512);
+
+        const size_t shown = std::min(_max_sites, sites.size());
+        for (size_t i = 0; i < shown; ++i) {
+            append_line(buffer, "", sites[i].file, sites[i].line, sites[i].count, sites[i].bytes);
+            flush_if_full(_out, buffer);
+        }
+
+        if (shown < sites.size()) {
+            buffer += "... " + std::to_string(sites.size() - shown) + " more site(s)\n";
+        }
+
+        buffer += std::to_string(total_bytes()) + " bytes in " + std::to_string(total_count()) + " allocation(s) from " + std::to_string(sites.size()) + " site(s).\n";
+        _out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
+
+    /**
+     * Writes the snapshot to a binary file.
+     *
+     * @param _path The path of the file.
+     * @return true if the file was written successfully.
+     */
+    bool save(const std::string &_path) const
+    {
+        std::ofstream out{_path, std::ios::binary};
+        if (!out) {
+            return false;
+        }
+
+        out.write(s_magic, sizeof(s_magic));
+        write_value(out, s_version);
+        write_value(out, time);
+        write_value(out, static_cast<std::uint64_t>(sites.size()));
+
+        for (const auto &val : sites) {
+            write_value(out, static_cast<std::uint32_t>(val.file.size()));
+            out.write(val.file.data(), static_cast<std::streamsize>(val.file.size()));
+            write_value(out, static_cast<std::uint64_t>(val.line));
+            write_value(out, static_cast<std::uint64_t>(val.count));
+            write_value(out, static_cast<std::uint64_t>(val.bytes));
+        }
+
+        return static_cast<bool>(out.flush());
+    }
+
+    /**
+     * Reads a snapshot written by save().
+     *
+     * @param _path The path of the file.
+     * @return The snapshot or std::nullopt if the file could not be read, is
+     * corrupt or is not a snapshot of the current version.
+     */
+    static std::optional<heap_snapshot> load(const std::string &_path)
+    {
+        std::ifstream in{_path, std::ios::binary};
+
+        // Determine the file size to validate lengths before allocating
+        in.seekg(0, std::ios::end);
+        const std::streamoff end = in.tellg();
+        in.seekg(0, std::ios::beg);
+
+        char          magic[sizeof(s_magic)];
+        std::uint32_t version{0};
+        std::uint64_t size{0};
+        heap_snapshot ret;
+
+        if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), s_magic) || !read_value(in, version) || version != s_version || !read_value(in, ret.time) || !read_value(in, size)) {
+            return std::nullopt;
+        }
+
+        for (std::uint64_t i = 0; i < size; ++i) {
+            std::uint32_t length{0};
+            std::uint64_t line{0};
+            std::uint64_t count{0};
+            std::uint64_t bytes{0};
+
+            // A corrupt length must not allocate more than the file holds
+            if (!read_value(in, length) || static_cast<std::streamoff>(length) > end - in.tellg()) {
+                return std::nullopt;
+            }
+
+            std::string file(length, '\0');
+            if (!in.read(file.data(), length) || !read_value(in, line) || !read_value(in, count) || !read_value(in, bytes)) {
+                return std::nullopt;
+            }
+
+            ret.sites.push_back({std::move(file), static_cast<size_t>(line), static_cast<size_t>(count), static_cast<size_t>(bytes)});
+        }
+
+        return ret;
+    }
+
+    /**
+     * Compares two snapshots. Sites missing in one of them count as empty.
+     *
+     * @param _before The older snapshot.
+     * @param _after The newer snapshot.
+     * @return The sites that changed, the one growing most first.
+     */
+    static std::vector<site_delta> diff(const heap_snapshot &_before, const heap_snapshot &_after)
+    {
+        std::vector<site_delta> ret;
+
+        // Sort both by site to merge them
+        std::vector<const site *> before = by_site(_before);
+        std::vector<const site *> after  = by_site(_after);
+
+        auto iter_before = before.begin();
+        auto iter_after  = after.begin();
+
+        while (iter_before != before.end() || iter_after != after.end()) {
+            if (iter_after == after.end() || (iter_before != before.end() && less_site(**iter_before, **iter_after))) {
+                // Site vanished
+                ret.push_back({(*iter_before)->file, (*iter_before)->line, -static_cast<std::int64_t>((*iter_before)->count), -static_cast<std::int64_t>((*iter_before)->bytes)});
+                ++iter_before;
+            } else if (iter_before == before.end() || less_site(**iter_after, **iter_before)) {
+                // Site appeared
+                ret.push_back({(*iter_after)->file, (*iter_after)->line, static_cast<std::int64_t>((*iter_after)->count), static_cast<std::int64_t>((*iter_after)->bytes)});
+                ++iter_after;
+            } else {
+                // Site present in both
+                const std::int64_t count = static_cast<std::int64_t>((*iter_after)->count) - static_cast<std::int64_t>((*iter_before)->count);
+                const std::int64_t bytes = static_cast<std::int64_t>((*iter_after)->bytes) - static_cast<std::int64_t>((*iter_before)->bytes);
+
+                if (count != 0 || bytes != 0) {
+                    ret.push_back({(*iter_after)->file, (*iter_after)->line, count, bytes});
+                }
+                ++iter_before;
+                ++iter_after;
+            }
+        }
+
+        std::sort(ret.begin(), ret.end(), [](const site_delta &_a, const site_delta &_b) { return _a.bytes > _b.bytes; });
+        return ret;
+    }
+
+    /**
+     * Writes one line per changed site, the one growing most first.
+     *
+     * @param _deltas The result of diff().
+     * @param _out The stream the changes are written to.
+     * @param _max_sites The maximum number of sites written.
+     */
+    static void print(const std::vector<site_delta> &_deltas, std::ostream &_out, const size_t &_max_sites = static_cast<size_t>(-1))
+    {
+        std::string buffer;
+        buffer.reserve(s_buffer_size + 512);
+
+        const size_t shown = std::min(_max_sites, _deltas.size());
+        for (size_t i = 0; i < shown; ++i) {
+            append_line(buffer, "+", _deltas[i].file, _deltas[i].line, _deltas[i].count, _deltas[i].bytes);
+            flush_if_full(_out, buffer);
+        }
+
+        if (shown < _deltas.size()) {
+            buffer += "... " + std::to_string(_deltas.size() - shown) + " more site(s)\n";
+        }
+
+        _out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
+
+  private:
+    // Appends a formatted line. Positive numbers are prefixed with _sign.
+    template <typename T>
+    static void append_line(std::string &_buffer, const char *_sign, const std::string &_file, const size_t &_line, const T &_count, const T &_bytes)
+    {
+        char numbers[96];
+        std::snprintf(numbers, sizeof(numbers), "%s%lld bytes in %s%lld allocation(s) at ", _bytes > 0 ? _sign : "", static_cast<long long>(_bytes), _count > 0 ? _sign : "", static_cast<long long>(_count));
+
+        _buffer += numbers;
+        _buffer += _file;
+        _buffer += ':';
+        _buffer += std::to_string(_line);
+        _buffer += '\n';
+    }
+
+    // Writes the buffer to a stream once it is full.
+    static void flush_if_full(std::ostream &_out, std::string &_buffer)
+    {
+        if (_buffer.size() >= s_buffer_size) {
+            _out.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+            _buffer.clear();
+        }
+    }
+
+    // Orders sites by file and line.
+    static bool less_site(const site &_a, const site &_b)
+    {
+        return _a.file < _b.file || (_a.file == _b.file && _a.line < _b.line);
+    }
+
+    // Returns pointers to the sites of a snapshot ordered by file and line.
+    static std::vector<const site *> by_site(const heap_snapshot &_snapshot)
+    {
+        std::vector<const site *> ret;
+        ret.reserve(_snapshot.sites.size());
+
+        for (const auto &val : _snapshot.sites) {
+            ret.push_back(&val);
+        }
+
+        std::sort(ret.begin(), ret.end(), [](const site *_a, const site *_b) { return less_site(*_a, *_b); });
+        return ret;
+    }
+
+    // Writes the bytes of a trivial value.
+    template <typename T>
+    static void write_value(std::ostream &_out, const T &_value)
+    {
+        _out.write(reinterpret_cast<const char *>(&_value), sizeof(T));
+    }
+
+    // Reads the bytes of a trivial value.
+    template <typename T>
+    static bool read_value(std::istream &_in, T &_value)
+    {
+        return static_cast<bool>(_in.read(reinterpret_cast<char *>(&_value), sizeof(T)));
+    }
+};
@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "bookkeeper.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Requests currently in flight, freed after a while.
+std::vector<char *> s_in_flight{};
+
+// Session data that is never released, i.e. a slow leak.
+std::vector<int *> s_sessions{};
+
+// Simulates one request of a long-running service.
+void handle_request(const size_t &_request)
+{
+    // Steady state: allocate a buffer and free an old one
+    s_in_flight.push_back(bookkeeper::alloc_array<char>(__FILE__, __LINE__, 256 + _request % 512));
+    if (s_in_flight.size() > 64) {
+        bookkeeper::dealloc_array(__FILE__, __LINE__, s_in_flight.front());
+        s_in_flight.erase(s_in_flight.begin());
+    }
+
+    // Slow leak: every tenth request keeps its session
+    if (_request % 10 == 0) {
+        s_sessions.push_back(bookkeeper::alloc_array<int>(__FILE__, __LINE__, 32));
+    }
+}
+
+// Takes two snapshots of a leaking service and writes them to files, which can
+// be compared using 05_tools_heap_diff.
+// Usage: 05_tools_heap_snapshot [before file] [after file]
+int main(int _argc, char **_argv)
+{
+    const std::string before_path{_argc > 1 ? _argv[1] : "before.snap"};
+    const std::string after_path{_argc > 2 ? _argv[2] : "after.snap"};
+
+    // Warm up and take the first snapshot
+    size_t request = 0;
+    for (; request < 10000; ++request) {
+        handle_request(request);
+    }
+
+    const heap_snapshot before = bookkeeper::snapshot();
+
+    // Keep running and take the second snapshot
+    for (; request < 50000; ++request) {
+        handle_request(request);
+    }
+
+    const heap_snapshot after = bookkeeper::snapshot();
+
+    std::cout << "Live allocations after " << request << " requests:\n";
+    after.print(std::cout, 10);
+
+    if (!before.save(before_path) || !after.save(after_path)) {
+        std::cerr << "Could not write snapshots.\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Snapshots written to " << before_path << " and " << after_path << ".\n";
+
+    // Tear down
+    for (char *val : s_in_flight) {
+        bookkeeper::dealloc_array(__FILE__, __LINE__, val);
+    }
+
+    for (int *val : s_sessions) {
+        bookkeeper::dealloc_array(__FILE__, __LINE__, val);
+    }
+
+    return bookkeeper::report_leaks();
+}
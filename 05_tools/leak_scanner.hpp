@@ -0,0 +1,409 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "bookkeeper.hpp"
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * A conservative leak scanner for allocations tracked by the bookkeeper, usable
+ * while the program keeps running (Linux only).
+ *
+ * Every pointer sized and aligned word in the roots is treated as a potential
+ * pointer. The roots are the stack and the callee-saved registers of the
+ * scanning thread, the writable segments (.data/.bss) of the executable as
+ * listed in /proc/self/maps and any range registered with add_root(). Tracked
+ * blocks reachable from the roots are scanned as well. Tracked blocks that are
+ * not reached are reported as leaks.
+ *
+ * To keep pauses short a scan is split into begin(), any number of step()
+ * calls with a work budget and finish(). The program may allocate and free in
+ * between, there is no write barrier though. Instead finish() repeats the
+ * marking: it rescans the roots, the blocks allocated after begin() and every
+ * marked block that is still tracked, since a block scanned by step() may have
+ * received a pointer afterwards. finish() therefore costs about as much as a
+ * complete scan, the steps only mark most blocks early.
+ *
+ * Limitations: the scanner reads the books of the bookkeeper without locking
+ * and only scans the stack of the calling thread, so it can only be used in
+ * single-threaded programs. Pointers that are only stored in untracked heap
+ * memory (e.g. in a std::vector) are not seen unless that memory is registered
+ * using add_root(). Stale stack values may hide leaks.
+ */
+class leak_scanner {
+  public:
+    // A struct describing an unreachable allocation.
+    struct leak {
+        void       *address;
+        std::string file;
+        size_t      line;
+        size_t      chars;
+    };
+
+  private:
+    // A tracked block as seen at the beginning of the scan.
+    struct block {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+        size_t         chars;
+        bool           marked;
+    };
+
+    // A marked block whose contents still have to be scanned.
+    struct pending_block {
+        size_t index;
+        size_t offset;
+    };
+
+    // A memory range that is scanned as root.
+    struct root_range {
+        const void *begin;
+        size_t      bytes;
+    };
+
+  private:
+    // Ranges registered by the user.
+    static inline std::vector<root_range> s_registered_roots{};
+
+    // Snapshot of the tracked blocks, sorted by address.
+    std::vector<block> m_blocks{};
+
+    // Snapshot of the root words that still have to be scanned.
+    std::vector<std::uintptr_t> m_roots{};
+
+    // The next root word to scan.
+    size_t m_root_cursor{0};
+
+    // Marked blocks that still have to be scanned.
+    std::vector<pending_block> m_pending{};
+
+    // True between begin() and finish().
+    bool m_running{false};
+
+  public:
+    /**
+     * Registers an additional memory range that is scanned as root, e.g. the
+     * buffer of a container storing tracked pointers.
+     *
+     * @param _begin The beginning of the range.
+     * @param _bytes The size of the range in bytes.
+     */
+    static void add_root(const void *_begin, const size_t &_bytes)
+    {
+        s_registered_roots.push_back({_begin, _bytes});
+    }
+
+    /**
+     * Removes a range previously registered with add_root().
+     *
+     * @param _begin The beginning of the range.
+     */
+    static void remove_root(const void *_begin)
+    {
+        s_registered_roots.erase(std::remove_if(s_registered_roots.begin(), s_registered_roots.end(), [_begin](const root_range &_range) { return _range.begin == _begin; }), s_registered_roots.end());
+    }
+
+    // Returns true if a scan was started but not finished.
+    bool running() const
+    {
+        return m_running;
+    }
+
+    // Starts a new scan. Captures the roots and the currently tracked blocks.
+    void begin()
+    {
+        m_roots.clear();
+        m_root_cursor = 0;
+        m_pending.clear();
+        m_blocks.clear();
+
+        // Capture roots before touching any tracked pointer on the stack
+        capture_roots();
+
+        // Snapshot the tracked blocks (the map is ordered by address)
+        m_blocks.reserve(bookkeeper::s_allocated_memory.size());
+        for (const auto &val : bookkeeper::s_allocated_memory) {
+            const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(val.first);
+
+            // Treat empty blocks as one char to allow them to be referenced
+            m_blocks.push_back({begin, begin + std::max<size_t>(val.second.chars, 1), val.second.chars, false});
+        }
+
+        m_running = true;
+    }
+
+    /**
+     * Performs a bounded amount of marking work.
+     *
+     * @param _budget The maximum number of words to inspect.
+     * @return true if marking is complete and finish() can be called without
+     * much remaining work.
+     */
+    bool step(size_t _budget)
+    {
+        // Scan the captured roots
+        while (_budget != 0 && m_root_cursor < m_roots.size()) {
+            mark(m_roots[m_root_cursor++]);
+            --_budget;
+        }
+
+        // Scan marked blocks
+        while (_budget != 0 && !m_pending.empty()) {
+            pending_block &current = m_pending.back();
+            const block   &b       = m_blocks[current.index];
+
+            // Skip blocks that were freed since begin()
+            if (!still_tracked(b)) {
+                m_pending.pop_back();
+                continue;
+            }
+
+            // Scan at most _budget words of the block
+            const size_t words  = b.chars / sizeof(std::uintptr_t);
+            const size_t amount = std::min(words - current.offset, _budget);
+            const size_t index  = current.index;
+            const size_t offset = current.offset;
+
+            current.offset += amount;
+            if (current.offset == words) {
+                m_pending.pop_back();
+            }
+
+            scan_range(reinterpret_cast<const void *>(m_blocks[index].begin + offset * sizeof(std::uintptr_t)), amount * sizeof(std::uintptr_t));
+            _budget -= amount;
+        }
+
+        return m_root_cursor == m_roots.size() && m_pending.empty();
+    }
+
+    /**
+     * Completes the scan. The roots are captured again, then the blocks
+     * allocated after begin() and all marked blocks are scanned again and
+     * marking is run to completion.
+     *
+     * @return The tracked blocks that existed at begin(), still exist and are
+     * not reachable.
+     */
+    std::vector<leak> finish()
+    {
+        // Finish remaining incremental work
+        while (!step(static_cast<size_t>(-1))) {
+        }
+
+        // Rescan the roots, they may have changed since begin()
+        m_roots.clear();
+        m_root_cursor = 0;
+        capture_roots();
+
+        // Treat blocks allocated during the scan as roots. A block may reuse
+        // (part of) the range of a snapshotted block freed in the meantime, so
+        // only an exact match counts as old
+        for (const auto &val : bookkeeper::s_allocated_memory) {
+            if (!snapshotted(reinterpret_cast<std::uintptr_t>(val.first), val.second.chars)) {
+                scan_range(val.first, val.second.chars);
+            }
+        }
+
+        // Rescan all marked blocks, their contents may have changed after
+        // they were scanned (e.g. the only pointer to an unscanned block was
+        // moved into one of them)
+        for (size_t i = 0; i < m_blocks.size(); ++i) {
+            if (m_blocks[i].marked) {
+                m_pending.push_back({i, 0});
+            }
+        }
+
+        while (!step(static_cast<size_t>(-1))) {
+        }
+
+        // Collect unreachable blocks that are still allocated
+        std::vector<leak> leaks;
+        for (const block &b : m_blocks) {
+            if (b.marked || !still_tracked(b)) {
+                continue;
+            }
+
+            const auto &entry = bookkeeper::s_allocated_memory.at(reinterpret_cast<void *>(b.begin));
+            leaks.push_back({reinterpret_cast<void *>(b.begin), entry.file, entry.line, entry.chars});
+        }
+
+        m_running = false;
+        m_blocks.clear();
+        m_roots.clear();
+
+        return leaks;
+    }
+
+    // Performs a complete scan at once.
+    std::vector<leak> scan()
+    {
+        begin();
+        return finish();
+    }
+
+    /**
+     * Writes the leaks returned by finish() or scan().
+     *
+     * @param _leaks The leaks.
+     * @param _out The stream the leaks are written to.
+     */
+    static void report(const std::vector<leak> &_leaks, std::ostream &_out)
+    {
+        for (const leak &val : _leaks) {
+            _out << "Unreachable allocation " << val.address << " from " << val.file << ":" << val.line << " (" << val.chars << " chars).\n";
+        }
+    }
+
+  private:
+    // Returns the index of the block containing _address or m_blocks.size().
+    size_t find(const std::uintptr_t &_address) const
+    {
+        auto iter = std::upper_bound(m_blocks.begin(), m_blocks.end(), _address, [](const std::uintptr_t &_value, const block &_block) { return _value < _block.begin; });
+
+        if (iter == m_blocks.begin()) {
+            return m_blocks.size();
+        }
+
+        --iter;
+        return _address < iter->end ? static_cast<size_t>(iter - m_blocks.begin()) : m_blocks.size();
+    }
+
+    // Returns true if a block with the given address and size is in m_blocks.
+    bool snapshotted(const std::uintptr_t &_begin, const size_t &_chars) const
+    {
+        const size_t index = find(_begin);
+        return index != m_blocks.size() && m_blocks[index].begin == _begin && m_blocks[index].chars == _chars;
+    }
+
+    // Returns true if the block is still tracked with the same size.
+    static bool still_tracked(const block &_block)
+    {
+        auto iter = bookkeeper::s_allocated_memory.find(reinterpret_cast<void *>(_block.begin));
+        return iter != bookkeeper::s_allocated_memory.end() && iter->second.chars == _block.chars;
+    }
+
+    // Marks the block a potential pointer points into.
+    void mark(const std::uintptr_t &_value)
+    {
+        const size_t index = find(_value);
+
+        if (index == m_blocks.size() || m_blocks[index].marked) {
+            return;
+        }
+
+        m_blocks[index].marked = true;
+        m_pending.push_back({index, 0});
+    }
+
+    // Marks all blocks referenced by the aligned words in a memory range.
+    void scan_range(const void *_begin, const size_t &_bytes)
+    {
+        std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(_begin);
+        std::uintptr_t end   = begin + _bytes;
+
+        // Only consider aligned words
+        begin = (begin + sizeof(std::uintptr_t) - 1) & ~(sizeof(std::uintptr_t) - 1);
+
+        for (std::uintptr_t iter = begin; iter + sizeof(std::uintptr_t) <= end; iter += sizeof(std::uintptr_t)) {
+            std::uintptr_t value;
+            std::memcpy(&value, reinterpret_cast<const void *>(iter), sizeof(value));
+            mark(value);
+        }
+    }
+
+    // Copies the aligned words of a memory range to m_roots.
+    void copy_range(const void *_begin, const size_t &_bytes)
+    {
+        std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(_begin);
+        std::uintptr_t end   = begin + _bytes;
+
+        begin = (begin + sizeof(std::uintptr_t) - 1) & ~(sizeof(std::uintptr_t) - 1);
+
+        for (std::uintptr_t iter = begin; iter + sizeof(std::uintptr_t) <= end; iter += sizeof(std::uintptr_t)) {
+            std::uintptr_t value;
+            std::memcpy(&value, reinterpret_cast<const void *>(iter), sizeof(value));
+            m_roots.push_back(value);
+        }
+    }
+
+    // Copies stack, registers, globals and registered ranges to m_roots.
+    __attribute__((noinline)) void capture_roots()
+    {
+        // Spill the callee-saved registers to the stack
+        std::jmp_buf registers;
+        setjmp(registers);
+
+        // Copy the used part of the stack starting at the spilled registers
+        pthread_attr_t attributes;
+        if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+            void  *stack_low;
+            size_t stack_size;
+            if (pthread_attr_getstack(&attributes, &stack_low, &stack_size) == 0) {
+                const std::uintptr_t top = reinterpret_cast<std::uintptr_t>(stack_low) + stack_size;
+                const std::uintptr_t sp  = reinterpret_cast<std::uintptr_t>(&registers);
+                copy_range(&registers, top - sp);
+            }
+            pthread_attr_destroy(&attributes);
+        }
+
+        // Copy the writable segments of the executable
+        capture_globals();
+
+        // Copy user supplied ranges
+        for (const root_range &range : s_registered_roots) {
+            copy_range(range.begin, range.bytes);
+        }
+    }
+
+    // Copies the writable mappings of the executable (.data/.bss) and the
+    // anonymous mapping directly following them (the rest of .bss).
+    void capture_globals()
+    {
+        char    executable[4096];
+        ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+        if (length <= 0) {
+            return;
+        }
+        executable[length] = '\0';
+
+        FILE *maps = std::fopen("/proc/self/maps", "r");
+        if (maps == nullptr) {
+            return;
+        }
+
+        char           line[4096 + 128];
+        std::uintptr_t previous_end = 0;
+        bool           previous_exe = false;
+        while (std::fgets(line, sizeof(line), maps) != nullptr) {
+            unsigned long begin, end;
+            char          permissions[5];
+            char          path[4096] = "";
+            if (std::sscanf(line, "%lx-%lx %4s %*s %*s %*s %4095s", &begin, &end, permissions, path) < 3) {
+                continue;
+            }
+
+            const bool is_exe       = std::strcmp(path, executable) == 0;
+            const bool is_writable  = permissions[0] == 'r' && permissions[1] == 'w';
+            const bool is_bss_spill = path[0] == '\0' && previous_exe && previous_end == begin;
+
+            if (is_writable && (is_exe || is_bss_spill)) {
+                copy_range(reinterpret_cast<const void *>(begin), end - begin);
+            }
+
+            previous_exe = is_exe;
+            previous_end = end;
+        }
+
+        std::fclose(maps);
+    }
+};
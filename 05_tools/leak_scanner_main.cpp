@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#include "bookkeeper.hpp"
+#include "leak_scanner.hpp"
+
+#include <cstddef>
+#include <iostream>
+
+// A tracked list node.
+struct node {
+    node *next;
+    int   value;
+};
+
+// Global head of a list of tracked nodes. Reachable through .bss.
+node *s_list = nullptr;
+
+// Global cache of tracked arrays. Reachable through .bss.
+int *s_cache[4] = {nullptr, nullptr, nullptr, nullptr};
+
+// Prepends a node to the global list.
+void push_node(const int &_value)
+{
+    node *n  = bookkeeper::alloc_array<node>(__FILE__, __LINE__, 1);
+    n->next  = s_list;
+    n->value = _value;
+    s_list   = n;
+}
+
+// Replaces a cache entry without deleting the previous array, i.e. leaks it.
+// Not inlined to keep the lost pointer out of the caller's stack frame.
+__attribute__((noinline)) void replace_cache_entry(const size_t &_round)
+{
+    s_cache[_round % 4] = bookkeeper::alloc_array<int>(__FILE__, __LINE__, 16 + _round);
+}
+
+// Simulates one round of work of a long-running service.
+void do_work(const size_t &_round)
+{
+    push_node(static_cast<int>(_round));
+    replace_cache_entry(_round);
+}
+
+// Main function of a service that never exits but leaks while running.
+int main()
+{
+    leak_scanner scanner;
+
+    for (size_t round = 0; round < 8; ++round) {
+        do_work(round);
+
+        // Scan with small budgets, keeping the service responsive in between
+        scanner.begin();
+        size_t steps = 1;
+        while (!scanner.step(256)) {
+            ++steps;
+        }
+
+        const auto leaks = scanner.finish();
+        std::cout << "Round " << round << ": " << steps << " step(s), " << leaks.size() << " unreachable allocation(s).\n";
+        leak_scanner::report(leaks, std::cout);
+    }
+
+    // Tear down the reachable data
+    while (s_list != nullptr) {
+        node *next = s_list->next;
+        bookkeeper::dealloc_array(__FILE__, __LINE__, s_list);
+        s_list = next;
+    }
+
+    for (int *&entry : s_cache) {
+        bookkeeper::dealloc_array(__FILE__, __LINE__, entry);
+        entry = nullptr;
+    }
+
+    // Report the leaked arrays (never freed)
+    return bookkeeper::report_leaks();
+}
@@ -0,0 +1,163 @@
+// SPDX-FileCopyrightText: 2024 J0R0U <https://github.com/J0R0U>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "bookkeeper.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+// Branch prediction hint for the rarely taken branch
+#if defined(__GNUC__) || defined(__clang__)
+#    define TRACKING_UNLIKELY(_condition) __builtin_expect(!!(_condition), 0)
+#else
+#    define TRACKING_UNLIKELY(_condition) (_condition)
+#endif
+
+// Allocation policies. Every policy offers the same static interface:
+//   T  *new_array<T>(file, line, amount);
+//   void delete_array(file, line, array);
+//   int  report_leaks();
+namespace tracking {
+
+// Allocates without any bookkeeping, compiles down to new[] and delete[].
+struct disabled {
+    template <typename T>
+    static T *new_array(const char *, const size_t &, const size_t &_amount)
+    {
+        return new T[_amount];
+    }
+
+    template <typename T>
+    static void delete_array(const char *, const size_t &, T *_array)
+    {
+        delete[] _array;
+    }
+
+    // Evaluates to EXIT_SUCCESS. No action performed.
+    static int report_leaks()
+    {
+        return EXIT_SUCCESS;
+    }
+};
+
+// Keeps track of every allocation using the bookkeeper. Thread-safe, every call
+// locks the mutex of the bookkeeper.
+struct enabled {
+    template <typename T>
+    static T *new_array(const char *_file, const size_t &_line, const size_t &_amount)
+    {
+        return bookkeeper::alloc_array<T>(_file, _line, _amount);
+    }
+
+    template <typename T>
+    static void delete_array(const char *_file, const size_t &_line, T *_array)
+    {
+        bookkeeper::dealloc_array(_file, _line, _array);
+    }
+
+    static int report_leaks()
+    {
+        return bookkeeper::report_leaks();
+    }
+};
+
+/**
+ * Decides once per process whether to use the bookkeeper. Tracking is enabled
+ * if the environment variable MYOM_TRACK_ALLOCATIONS is set to 1 when the first
+ * allocation happens. Afterwards the decision cannot change, so every array is
+ * freed by the same policy that allocated it. If tracking is disabled each call
+ * costs one load and one well predicted branch on top of new[]/delete[]. If it
+ * is enabled, all threads allocating serialize on the mutex of the bookkeeper.
+ */
+class runtime {
+  private:
+    // The possible tracking states.
+    enum state : unsigned char {
+        unknown,
+        off,
+        on
+    };
+
+    // The current state. Constant initialized, so it is valid even during
+    // static initialization of other objects. Atomic since the first calls may
+    // happen concurrently. Relaxed ordering suffices: every thread computes the
+    // same value and nothing else is published through it.
+    static inline std::atomic<state> s_state{unknown};
+
+    // Reads the environment variable and fixes the state.
+    static bool initialize()
+    {
+        const char *value = std::getenv("MYOM_TRACK_ALLOCATIONS");
+        const state ret   = (value != nullptr && std::strcmp(value, "1") == 0) ? on : off;
+
+        s_state.store(ret, std::memory_order_relaxed);
+        return ret == on;
+    }
+
+  public:
+    // Returns true if allocations have to be tracked. The slow path is only
+    // taken if tracking is on or the state is not known yet.
+    static bool active()
+    {
+        const state current = s_state.load(std::memory_order_relaxed);
+
+        if (TRACKING_UNLIKELY(current != off)) {
+            return current == on || initialize();
+        }
+
+        return false;
+    }
+
+    template <typename T>
+    static T *new_array(const char *_file, const size_t &_line, const size_t &_amount)
+    {
+        if (active()) {
+            return enabled::new_array<T>(_file, _line, _amount);
+        }
+
+        return disabled::new_array<T>(_file, _line, _amount);
+    }
+
+    template <typename T>
+    static void delete_array(const char *_file, const size_t &_line, T *_array)
+    {
+        if (active()) {
+            enabled::delete_array(_file, _line, _array);
+        } else {
+            disabled::delete_array(_file, _line, _array);
+        }
+    }
+
+    static int report_leaks()
+    {
+        return active() ? enabled::report_leaks() : disabled::report_leaks();
+    }
+};
+
+} // namespace tracking
+
+// The policy used by the TRACKED_* macros. Can be set by the build system to
+// tracking::disabled, tracking::enabled or tracking::runtime.
+#ifndef TRACKING_POLICY
+#    define TRACKING_POLICY tracking::runtime
+#endif
+
+// Used to allocate an array of a given type and size. Keeps track of the
+// returned pointer if the policy tracks allocations.
+#define TRACKED_new_array(_type, _amount) \
+    TRACKING_POLICY::new_array<_type>(__FILE__, __LINE__, _amount)
+
+// Used to deallocate a previous allocated array. Checks if the pointer is
+// monitored and removes the corresponding entry if the policy tracks
+// allocations.
+#define TRACKED_delete_array(_ptr) \
+    TRACKING_POLICY::delete_array(__FILE__, __LINE__, _ptr)
+
+// Reports memory leaks if the policy tracks allocations, otherwise evaluates to
+// EXIT_SUCCESS.
+#define TRACKED_report_leaks() \
+    TRACKING_POLICY::report_leaks()